@@ -0,0 +1,76 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+class KmcEngine;
+
+// restartable state of a running simulation: the lattice occupation, the
+// engine clock and accumulators, the random generator and event selector
+// state, and any series or counters the caller keeps
+// a restored engine continues with exactly the same events, times and
+// energies as the one that was captured
+class Checkpoint
+{
+public:
+    Checkpoint();
+
+    void capture(const KmcEngine &engine);
+    // the engine lattice must hold the model the checkpoint was taken from
+    bool restore(KmcEngine *engine, QString *error = 0) const;
+
+    long steps() const { return m_steps; }
+    double time() const { return m_time; }
+
+    void setSeries(const QString &name, const QVector<double> &values) { m_series.insert(name, values); }
+    QVector<double> series(const QString &name) const { return m_series.value(name); }
+    void setCounter(const QString &name, qint64 value) { m_counters.insert(name, value); }
+    bool hasCounter(const QString &name) const { return m_counters.contains(name); }
+    qint64 counter(const QString &name) const { return m_counters.value(name); }
+
+    // written to a temporary file which then replaces the old checkpoint, so
+    // an interrupted write never leaves a damaged file
+    bool write(const QString &filename, QString *error = 0) const;
+    bool read(const QString &filename, QString *error = 0);
+
+    static const quint32 version = 2;
+
+private:
+    qint32 m_nsites;
+    qint32 m_ntrans;
+    quint64 m_model; // fingerprint of the transition graph
+    QByteArray m_occ;
+
+    double m_temp;
+    double m_time;
+    qint64 m_steps;
+    double m_xdisp;
+    double m_ydisp;
+    double m_energy;
+    qint32 m_sinceRebuild;
+    bool m_ratesValid;
+
+    qint32 m_generator;
+    quint64 m_seed;
+    quint64 m_stream;
+    QVector<quint64> m_rngState;
+    qint32 m_selector;
+    QVector<quint64> m_selectorState;
+
+    QMap<QString, QVector<double> > m_series;
+    QMap<QString, qint64> m_counters;
+};
+
+#endif // CHECKPOINT_H
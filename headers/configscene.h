@@ -13,6 +13,7 @@
 #include "latsite.h"
 
 #include <QGraphicsScene>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QGraphicsSceneMouseEvent;
@@ -26,6 +27,9 @@ class QColor;
 class Site;
 QT_END_NAMESPACE
 
+class Transition;
+class Lattice;
+
 class ConfigScene : public QGraphicsScene
 {
     Q_OBJECT
@@ -34,9 +38,9 @@ public:
     enum Mode { InsertUSite, InsertSite, InsertTrans, MoveItem };
 
     explicit ConfigScene(QMenu *siteMenu, QMenu *transMenu,int xc, int yc, QObject *parent = 0);
-    void addSite(bool ostate, double en, double xc, double yc, int sindx, int xrep, int yrep,
+    Site *addSite(bool ostate, double en, double xc, double yc, int sindx, int xrep, int yrep,
              double m1, double m2, double m3, double m4, double m5, double m6);
-    void addTrans(Site *myStartItem, Site *myEndItem, double nbar, int id, double startPF, double endPF);
+    Transition *addTrans(Site *myStartItem, Site *myEndItem, double nbar, int id, double startPF, double endPF);
     void addTransPair(Site *myStartItem1, Site *myEndItem1,Site *myStartItem2, Site *myEndItem2, double nbar);
 
     int getGridSize() const { return this->gridSize; }
@@ -44,6 +48,13 @@ public:
     void setSnap(bool dosnap) { snap = dosnap; }
     void changeCell(int xcelln, int ycelln) { xcell = xcelln; ycell = ycelln; }
 
+    // periodic images are only created where they can be seen or used: near
+    // the cell edges (within the margin) or at the end of a boundary transition
+    void setImageMargin(double margin) { imageMargin = margin; }
+    double getImageMargin() const { return imageMargin; }
+    Site *siteImage(Site *site, int sx, int sy); // the image translated by (sx, sy) cells, created if needed
+    void updateImages(Site *site); // place the images in the current cell and add those near the edges
+
     void setTransMin1(double energy);
     void setTransMin2(double energy);
     void setTransBar(double energy);
@@ -52,12 +63,22 @@ public:
     void setStartPreFac(double pf);
     void setEndPreFac(double pf);
 
+    void buildLattice(Lattice *lattice, QVector<Site *> *sites, QVector<Transition *> *transitions);
+    // the items of each lattice site and transition are returned in lattice
+    // order if asked for, so the lattice need not be built again
+    bool loadLattice(const Lattice &lattice, QVector<Site *> *sites = 0, QVector<Transition *> *transitions = 0,
+                     QString *error = 0);
+    // the scene has images of the 8 neighbouring cells only: a transition
+    // shifted further cannot be drawn
+    static bool checkLattice(const Lattice &lattice, QString *error = 0);
+
 public slots:
     void setMode(Mode mode);
 
 signals:
     void itemSelected(QGraphicsItem *item);
     void itemdeSelected(QGraphicsItem *item);
+    void modelChanged(); // sites or transitions added or moved
 
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent) Q_DECL_OVERRIDE;
@@ -66,6 +87,7 @@ protected:
 
 private:
     bool isItemChange(int type);
+    Site *addImage(Site *site, int img);
 
     QMenu *mySiteMenu;
     QMenu *myTransMenu;
@@ -79,6 +101,7 @@ private:
     int ycell; // cell y dimension
     int indx; // index for linking periodic transitions
     int gridSize;
+    double imageMargin; // distance outside the cell in which images are shown
     bool snap;
 };
 
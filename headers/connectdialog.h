@@ -0,0 +1,47 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef CONNECTDIALOG
+#define CONNECTDIALOG
+
+#include <QDialog>
+#include <QtWidgets>
+#include <QLineEdit>
+
+class ConnectDialog : public QDialog   //auto-connect sites by cutoff dialog box
+{
+    Q_OBJECT
+
+public:
+    ConnectDialog(void);
+    double cutoff() { return m_cutoff; }
+    double barrier() { return m_barrier; }
+    double startPrefac() { return m_startPF; }
+    double endPrefac() { return m_endPF; }
+    int cancel() { return cncl; }
+
+private slots:
+    void okButtonPress();
+    void cancelButtonPress();
+
+private:
+    QLineEdit *cutoffEdit;
+    QLineEdit *barrierEdit;
+    QLineEdit *startPFEdit;
+    QLineEdit *endPFEdit;
+    QPushButton *okButton;
+    QPushButton *cancelButton;
+    double m_cutoff;
+    double m_barrier;
+    double m_startPF;
+    double m_endPF;
+    int cncl;
+};
+
+#endif // CONNECTDIALOG
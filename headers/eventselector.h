@@ -0,0 +1,40 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef EVENTSELECTOR_H
+#define EVENTSELECTOR_H
+
+#include <QVector>
+
+// interface for the rate-weighted selection of KMC events
+class EventSelector
+{
+public:
+    enum Type { Tree, RateClass };
+
+    virtual ~EventSelector() {}
+
+    virtual Type type() const = 0;
+    virtual void resize(int n) = 0; // n events, all with zero rate
+    virtual int size() const = 0;
+    virtual void setRates(const QVector<double> &rates) = 0;
+    virtual void setRate(int i, double rate) = 0;
+    virtual double rate(int i) const = 0;
+    virtual double total() const = 0;
+    virtual int select(double ran) const = 0; // ran uniform on (0,1], -1 if the total is zero
+
+    // internal ordering that selection depends on beyond the rates, for exact
+    // restarts: applied after setRates with the same rates
+    virtual QVector<quint64> state() const { return QVector<quint64>(); }
+    virtual bool setState(const QVector<quint64> &state) { return state.isEmpty(); }
+
+    static EventSelector *create(Type type);
+};
+
+#endif // EVENTSELECTOR_H
@@ -0,0 +1,51 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef GENERATORDIALOG
+#define GENERATORDIALOG
+
+#include <QDialog>
+#include <QtWidgets>
+#include <QLineEdit>
+
+class LatticeGenerator;
+
+class GeneratorDialog : public QDialog   //procedural lattice generator dialog box
+{
+    Q_OBJECT
+
+public:
+    GeneratorDialog(void);
+    void configure(LatticeGenerator *generator) const; // the entered parameters
+    bool fileOnly() const { return m_fileOnly; } // save without building the scene
+    int cancel() { return cncl; }
+
+private slots:
+    void okButtonPress();
+    void cancelButtonPress();
+
+private:
+    QComboBox *typeComboBox;
+    QLineEdit *xEdit;
+    QLineEdit *yEdit;
+    QLineEdit *spacingEdit;
+    QLineEdit *siteEnEdit;
+    QLineEdit *nnModEdit[6];
+    QLineEdit *barrierEdit;
+    QLineEdit *startPFEdit;
+    QLineEdit *endPFEdit;
+    QLineEdit *coverageEdit;
+    QCheckBox *fileOnlyCheckBox;
+    QPushButton *okButton;
+    QPushButton *cancelButton;
+    bool m_fileOnly;
+    int cncl;
+};
+
+#endif // GENERATORDIALOG
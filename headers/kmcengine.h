@@ -0,0 +1,122 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef KMCENGINE_H
+#define KMCENGINE_H
+
+#include <QVector>
+
+#include "eventselector.h"
+#include "rng.h"
+
+class Lattice;
+
+// a single executed KMC event
+struct KmcEvent
+{
+    int trans; // transition index
+    int from;  // site the particle left
+    int to;    // site the particle moved to
+    double dx; // hop displacement (Angstrom)
+    double dy;
+};
+
+// kinetic Monte Carlo engine operating on a flat Lattice
+// every transition provides two events: 2*t (start -> end) and 2*t+1 (end -> start)
+class KmcEngine
+{
+public:
+    explicit KmcEngine(Lattice *lattice = 0);
+    ~KmcEngine();
+
+    void setLattice(Lattice *lattice);
+    Lattice *lattice() const { return m_lattice; }
+    void setTemperature(double temp);
+    double temperature() const { return m_temp; }
+    void reset(); // zero the time, step count and displacement
+    void setSelector(EventSelector::Type type);
+    EventSelector::Type selector() const { return m_rates->type(); }
+
+    // random numbers: each engine owns its generator and stream
+    void setGenerator(RandomGenerator::Type type); // reseeded with the current seed
+    RandomGenerator::Type generator() const { return m_rng->type(); }
+    void seedRandom(quint64 seed, quint64 stream = 0);
+    double uniform() { return m_rng->uniform(); } // on (0,1]
+
+    // rate catalog: built once, then updated locally after each event
+    void buildRates();
+    void prepareRates() { if(!m_ratesValid) buildRates(); }
+    void invalidateRates() { m_ratesValid = false; } // occupation changed externally
+    int eventCount() const { return m_rates->size(); }
+    double rate(int e) const { return m_rates->rate(e); }
+    double barrier(int e) const;
+    double prefactor(int e) const;
+    int eventTrans(int e) const { return e/2; }
+    int eventFrom(int e) const;
+    int eventTo(int e) const;
+    double totalRate() const { return m_rates->total(); }
+    double energy() const { return m_energy; }
+
+    // the three stages of a KMC step
+    int selectEvent(double ran) const; // returns -1 if no event is possible
+    void performEvent(int e, KmcEvent *event = 0);
+    double advanceTime(double ran); // uses the escape rate before the last event
+    bool step(double ran1, double ran2, KmcEvent *event = 0);
+    bool step(KmcEvent *event = 0) { double ran1 = uniform(); return step(ran1, uniform(), event); }
+
+    double time() const { return m_time; }
+    long steps() const { return m_nstep; }
+    double xDisplacement() const { return m_xdisp; } // accumulated (Angstrom)
+    double yDisplacement() const { return m_ydisp; }
+
+    // dirty set: sites whose occupation (or view highlight) changed since it
+    // was last taken, each listed once however many events touched it, so a
+    // frame costs the number of sites changed rather than the model size
+    void markDirty(int i);
+    void takeDirty(QVector<int> *sites); // appends the set and empties it
+
+    static const double lengthScale; // scene units to Angstrom
+
+private:
+    friend class Checkpoint; // restarts restore the accumulated state exactly
+
+    double siteMod(int i) const;
+    double eventRate(int e) const;
+    void addAffected(int i);
+
+    Lattice *m_lattice;
+    double m_temp; // simulation temperature
+    double m_beta; // Boltzman factor
+    double m_time; // simulation time
+    long m_nstep; // KMC step
+    double m_energy; // instantaneous energy
+    double m_xdisp; // accumulated displacement
+    double m_ydisp;
+
+    RandomGenerator *m_rng;
+    quint64 m_seed;
+    quint64 m_stream;
+
+    EventSelector *m_rates; // rate of every event (zero if inactive)
+    QVector<double> m_mod; // coordination modifier of every site
+    double m_escapeRate; // total rate of the state before the last event
+    bool m_ratesValid;
+    int m_sinceRebuild; // incremental energy updates since the last full sum
+
+    // sites and transitions touched by the last event
+    QVector<int> m_affected;
+    QVector<int> m_siteMark;
+    QVector<int> m_transMark;
+    int m_stamp;
+
+    QVector<int> m_dirty;
+    QVector<char> m_dirtyMark;
+};
+
+#endif // KMCENGINE_H
@@ -0,0 +1,60 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef KMCWORKER_H
+#define KMCWORKER_H
+
+#include <QAtomicInt>
+#include <QThread>
+
+#include "snapshot.h"
+
+class KmcEngine;
+class TrajectoryWriter;
+
+// runs the KMC engine on its own thread
+// the engine and its lattice belong to the worker while it is running: the
+// view only reads the published snapshots and series chunks, which carry the
+// sites changed by each batch
+class KmcWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit KmcWorker(QObject *parent = 0);
+    ~KmcWorker();
+
+    // publish a snapshot every batch of steps or budget milliseconds
+    void startRun(KmcEngine *engine, int batchSteps, int budget);
+    void stopRun(); // returns when the thread has finished
+    void setTrajectory(TrajectoryWriter *trajectory) { m_trajectory = trajectory; } // 0 to stop recording
+
+    bool readSnapshot() { return m_snapshots.read(); }
+    const KmcSnapshot &snapshot() const { return m_snapshots.front(); }
+    SeriesChunk *takeSeries(); // caller deletes, 0 when there is nothing new
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    void takeDirty();
+    void publish(bool stalled);
+
+    KmcEngine *m_engine;
+    TrajectoryWriter *m_trajectory;
+    int m_batchSteps;
+    int m_budget;
+    QAtomicInt m_stop;
+
+    SnapshotBuffer m_snapshots;
+    ChunkQueue m_series;
+    SeriesChunk *m_chunk; // being filled by the worker thread
+};
+
+#endif // KMCWORKER_H
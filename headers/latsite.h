@@ -49,13 +49,16 @@ public:
     float en() { return energy; }
     void on() { state = 1; }  //turn occupation on and off
     void off() { state = 0; }
-    int stat() { return state; } // return occupation
+    int stat() const; // return occupation: images show the parent site
     void setNNMod(int nn, double men) { nnmod[nn] = men; } // set the coordination modifier
     void setNNMod(double men1, double men2, double men3, double men4, double men5, double men6);
     double nnMod(int nn) { return nnmod[nn]; }
 
     //periodic cell information
     int img() { return m_img; }
+    void setIndex(int index) { m_index = index; } // lattice site index
+    int index() const; // images resolve to the parent site index
+    void cellShift(int *sx, int *sy) const; // image cell translation
     void setID(int id) { m_id = id; }
     int id() { return m_id; }
     void setRep(int xrep, int yrep) { m_xrep = xrep; m_yrep = yrep; }
@@ -83,6 +86,7 @@ private:
     QMenu *myContextMenu;
     QList<Transition *> transitions; // list of site transitions
     int m_id; // indexing
+    int m_index; // lattice site index (set by ConfigScene::buildLattice)
     int m_xrep,m_yrep; // replication indexing
     int m_highlight; //site highlight
 };
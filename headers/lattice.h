@@ -0,0 +1,112 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef LATTICE_H
+#define LATTICE_H
+
+#include <QVector>
+#include <QMultiHash>
+
+// flat (struct-of-arrays) lattice model used by the simulation engine
+// sites are indexed 0..siteCount()-1 and periodic images are resolved to
+// their parent site, transitions are stored once per physical pathway
+class Lattice
+{
+public:
+    Lattice();
+
+    void clear();
+    void setCell(int xcell, int ycell) { m_xcell = xcell; m_ycell = ycell; }
+    int xCell() const { return m_xcell; }
+    int yCell() const { return m_ycell; }
+
+    // model construction: call finalise() after the last transition is added
+    int addSite(double x, double y, int occ, double en, const double *nnmod);
+    int addTransition(int start, int end, double en, double startPF, double endPF,
+                      int shiftX, int shiftY, int pairId = 0);
+    void finalise();
+
+    // replicate the cell nx by ny times: site i of replica (rx, ry) becomes
+    // i + siteCount()*(rx + nx*ry), so replica (0, 0) keeps the original
+    // numbering, and every transition is repeated with its end wrapped into
+    // the enlarged cell (the lattice is finalised again)
+    bool expand(int nx, int ny);
+
+    int siteCount() const { return m_occ.size(); }
+    int transCount() const { return m_transStart.size(); }
+
+    // site properties
+    double x(int i) const { return m_x[i]; }
+    double y(int i) const { return m_y[i]; }
+    int occ(int i) const { return m_occ[i]; }
+    void setOcc(int i, int occ); // keeps the neighbour counters up to date
+    double en(int i) const { return m_en[i]; }
+    double nnMod(int i, int nn) const { return m_nnmod[i*7 + nn]; }
+
+    // transition properties
+    int transStart(int t) const { return m_transStart[t]; }
+    int transEnd(int t) const { return m_transEnd[t]; }
+    double transEn(int t) const { return m_transEn[t]; }
+    double startPrefac(int t) const { return m_startPF[t]; }
+    double endPrefac(int t) const { return m_endPF[t]; }
+    // the end site image reached from the start site is the end site
+    // translated by (shiftX, shiftY) lattice vectors
+    int transShiftX(int t) const { return m_shiftX[t]; }
+    int transShiftY(int t) const { return m_shiftY[t]; }
+    double transDx(int t) const { return m_x[m_transEnd[t]] + m_shiftX[t]*m_xcell - m_x[m_transStart[t]]; }
+    double transDy(int t) const { return m_y[m_transEnd[t]] + m_shiftY[t]*m_ycell - m_y[m_transStart[t]]; }
+
+    // CSR adjacency: transitions attached to site i are
+    // adjTrans(k) for k in [adjBegin(i), adjEnd(i))
+    int adjBegin(int i) const { return m_adjOffset[i]; }
+    int adjEnd(int i) const { return m_adjOffset[i+1]; }
+    int adjTrans(int k) const { return m_adjTrans[k]; }
+    int adjSite(int k) const { return m_adjSite[k]; } // the other end of adjTrans(k)
+
+    // occupied neighbours of site i (one per attached transition)
+    int occNeighbours(int i) const { return m_nocc[i]; }
+    // coordination of an occupied site: zero if the site is empty
+    int coordination(int i) const { return m_occ[i] ? m_nocc[i] : 0; }
+
+    // periodic image number (1-8) to cell translation
+    static void imageShift(int img, int *sx, int *sy);
+
+private:
+    friend class ModelIO; // binary models are copied straight into the arrays
+    void countNeighbours();
+
+    int m_xcell; // cell x dimension
+    int m_ycell; // cell y dimension
+
+    // sites
+    QVector<double> m_x;
+    QVector<double> m_y;
+    QVector<int> m_occ; // occupation: 0 = unoccupied, 1 = occupied
+    QVector<double> m_en; // site energy
+    QVector<double> m_nnmod; // coordination modifiers, 7 per site
+
+    // transitions
+    QVector<int> m_transStart;
+    QVector<int> m_transEnd;
+    QVector<double> m_transEn; // barrier energy
+    QVector<double> m_startPF; // forward prefactor
+    QVector<double> m_endPF; // backward prefactor
+    QVector<int> m_shiftX; // end image cell translation
+    QVector<int> m_shiftY;
+
+    // site to transition adjacency
+    QVector<int> m_adjOffset;
+    QVector<int> m_adjTrans;
+    QVector<int> m_adjSite;
+    QVector<int> m_nocc; // occupied neighbour counters (built by finalise)
+
+    QMultiHash<int, int> m_pairIndex; // periodic pair ID -> transition (build only)
+};
+
+#endif // LATTICE_H
@@ -0,0 +1,65 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef LATTICEGENERATOR_H
+#define LATTICEGENERATOR_H
+
+#include <QString>
+
+class Lattice;
+
+// procedural supercells of a Bravais lattice with basis, written straight
+// into the lattice core: every site gets the same energy and coordination
+// modifiers and every nearest-neighbour pair one transition, wrapped
+// periodically at the cell edges
+//   Square     - 1 site per rectangular unit cell, coordination 4
+//   Hexagonal  - 2 sites per rectangular unit cell, coordination 6
+//   Honeycomb  - 4 sites per rectangular unit cell, coordination 3
+class LatticeGenerator
+{
+public:
+    enum Type { Square, Hexagonal, Honeycomb };
+
+    LatticeGenerator();
+
+    void setType(Type type) { m_type = type; }
+    void setSize(int nx, int ny) { m_nx = nx; m_ny = ny; } // unit cells, at least 2 each
+    void setSpacing(double spacing) { m_spacing = spacing; } // nearest-neighbour distance
+    void setSiteEnergy(double en) { m_siteEn = en; }
+    void setNNMod(int nn, double mod) { m_nnmod[nn] = mod; } // nn = 1..6
+    void setBarrier(double en) { m_barrier = en; }
+    void setPrefactors(double startPF, double endPF) { m_startPF = startPF; m_endPF = endPF; }
+    void setCoverage(double coverage, quint64 seed) { m_coverage = coverage; m_seed = seed; }
+
+    // replaces the contents of the lattice and finalises it
+    bool generate(Lattice *lattice, QString *error = 0) const;
+
+    static bool typeFromName(const QString &name, Type *type);
+
+    // auto-connect: add a transition for every pair of sites closer than the
+    // cutoff (minimum image in the periodic cell) that is not already joined,
+    // using a cell list so the cost is linear in the number of sites
+    static bool connect(Lattice *lattice, double cutoff, double barrier, double startPF, double endPF,
+                        int *added = 0, QString *error = 0);
+
+private:
+    Type m_type;
+    int m_nx;
+    int m_ny;
+    double m_spacing;
+    double m_siteEn;
+    double m_nnmod[7];
+    double m_barrier;
+    double m_startPF;
+    double m_endPF;
+    double m_coverage; // fraction of sites occupied at random
+    quint64 m_seed;
+};
+
+#endif // LATTICEGENERATOR_H
@@ -12,12 +12,20 @@
 
 #include "latsite.h"
 #include "curvedisplay.h"
+#include "kmcengine.h"
 
 #include <QMainWindow>
 #include <QWidget>
 #include <QtWidgets>
 
 class ConfigScene;
+class Lattice;
+class KmcWorker;
+class TrajectoryWriter;
+class TrajectoryReader;
+class SeriesRecorder;
+class Transition;
+class RasterView;
 
 QT_BEGIN_NAMESPACE
 class QAction;
@@ -33,6 +41,7 @@ class QToolButton;
 class QAbstractButton;
 class QGraphicsView;
 class QSlider;
+class QStackedWidget;
 QT_END_NAMESPACE
 class CurveDisplay;
 
@@ -46,7 +55,11 @@ public:
 
 private slots:
     void openfile();
+    void importSites();
     void savefile();
+    void saveCheckpoint();
+    void restoreCheckpoint();
+    void toggleSpill(bool on);
     void exportSVG();
     void print();
     void deleteItem();
@@ -55,8 +68,13 @@ private slots:
     void toggleImages(bool on);
     void toggleSnap(bool on);
     void changeCellSize();
+    void changeImageMargin();
     void expandSystem();
+    void generateLattice();
+    void autoConnect();
     void setupMatrix();
+    void toggleRaster(bool on);
+    void toggleEnergyColor(bool on);
     void about();
     void occupied();
     void unoccupied();
@@ -74,9 +92,14 @@ private slots:
     void endModCBChanged();
     void setTemp(int tmp);
     void setSeed(int isd);
+    void generatorChanged(int index);
     void setDelay(double delay);
     void simDetailChanged();
+    void selectorChanged(int index);
     void toggleRecord(bool on);
+    void toggleReplay(bool on);
+    void timelineChanged(int value);
+    void seekTrajectory();
 
     void startKMC();
     void stopKMC();
@@ -84,6 +107,7 @@ private slots:
     void resetSimulation();
     void rewindSimulation();
     void openGraphBox();
+    void invalidateLattice();
 
     void closeEvent(QCloseEvent *event);
 
@@ -94,10 +118,28 @@ private:
     void createMenus();
     void drawCells();
     void redrawCells();
+    void loadModel(const Lattice &model);
+    void updateImages();
+    void removeItems();
+    void currentModel(Lattice *model);
+    void buildLattice();
+    void syncSite(int i);
+    void showSite(int i, int occ);
+    void showChanges();
+    void setHighlight(int i);
+    void highlightTrans(int t, bool on);
+    void runBatch();
+    void startWorker();
+    bool stopWorker();
+    void takeSeries();
+    void showSnapshot();
+    void showReplayEvent(qint64 event);
 
     //mainwindow components
     ConfigScene *scene;
     QGraphicsView *view;
+    RasterView *rasterView; // lattice drawn without scene items
+    QStackedWidget *viewStack;
     QGraphicsRectItem *cell;
     QGraphicsRectItem *perarea;
     CurveDisplay *curveDisplay;
@@ -111,14 +153,24 @@ private:
     QAction *setUnoccupied;
     QAction *printAction;
     QAction *openAction;
+    QAction *importAction;
     QAction *saveAction;
     QAction *clearAction;
+    QAction *generateAction;
+    QAction *connectAction;
+    QAction *marginAction;
+    QAction *rasterAction;
+    QAction *energyColorAction;
     QAction *exportAction;
+    QAction *checkpointAction;
+    QAction *restoreAction;
+    QAction *spillAction;
     QAction *aboutAction;
 
     //menus
     QMenu *fileMenu;
     QMenu *itemMenu;
+    QMenu *viewMenu;
     QMenu *aboutMenu;
     QMenu *siteMenu;
     QMenu *transMenu;
@@ -154,6 +206,7 @@ private:
     //simulation toolbox
     QSpinBox *temperature;
     QSpinBox *seed;
+    QComboBox *generatorComboBox;
     QAction *startAction;
     QAction *stopAction;
     QToolButton *startStopButton;
@@ -164,7 +217,15 @@ private:
 
     QDoubleSpinBox *delaySpinBox;
     QToolButton *recordButton;
+    QSpinBox *strideSpinBox;
+    QToolButton *replayButton;
+    QSlider *timelineSlider;
+    QComboBox *seekComboBox;
+    QLineEdit *seekEdit;
     QComboBox *detailComboBox;
+    QComboBox *selectorComboBox;
+    QSpinBox *batchSpinBox;
+    QSpinBox *budgetSpinBox;
     QLabel *simulationTime;
     QTextEdit *simulationStatus;
 
@@ -174,31 +235,38 @@ private:
     long nstep; // KMC step
     int pstep; // detail step
     int kmcDetail; // detail printing
-    double m_temp; // simulation temperature
-    double m_beta; // Boltzman factor
+    bool fastMode; // batch steps per timer tick
     double m_time; // simulation time
     double m_energy; // instantaneous energy
-    bool recordTraj;
 
-    QList<QPointF> barPFList; // active barrier and PF list
-    QList<double> rateList; // list of all the exit rates
-    QList<QGraphicsItem *> transList; //list of transition pointers
-    double rateTotal; // the sum of all the exit pathway rates
-    QGraphicsItem *transPath; // the chosen path
+    // simulation engine: the scene only observes the lattice state
+    Lattice *lattice; // flat copy of the scene model
+    KmcEngine *engine;
+    KmcWorker *worker; // runs the engine in fast mode
+    TrajectoryWriter *trajectory; // recording behind the record button
+    KmcEvent stepEvent; // the event of the current detailed step
+    TrajectoryReader *replay; // event trajectory behind the timeline slider
+    qint64 replayEvent; // event shown by the view, -1 if the lattice has moved on
+    long replaySteps; // engine step count when the event was shown
+    QVector<char> replayOcc; // occupation at replayEvent
+    bool workerActive;
+    bool latticeDirty; // scene edited since the lattice was built
+    bool rasterMode; // the scene is empty: the lattice is the model
+    QVector<Site *> siteItems; // scene item for each lattice site
+    QVector<Transition *> transItems; // scene item for each lattice transition
+    int transEvent; // the chosen event
+    int highlightSite; // the highlighted destination site
+    QVector<int> litTrans; // transitions highlighted during the current step
     QList<int> initConf; // the initial site configuration
 
     // statistics: time series
-    QVector<double> timeSeries; // record if time steps
-    QVector<double> energySeries; // total energy
+    SeriesRecorder *series; // time, energy and displacement of every step
     QVector<int> coordSeries1; // coordination histogram
     QVector<int> coordSeries2;
     QVector<int> coordSeries3;
     QVector<int> coordSeries4;
     QVector<int> coordSeries5;
     QVector<int> coordSeries6;
-    QVector<double> displaceXSeries; // displacement list
-    QVector<double> displaceYSeries; // displacement list
-    QVector<double> displaceSquared; // displacement list
 
     //periodic images
     int xcell; // x cell dimension
@@ -0,0 +1,49 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef MODELIO_H
+#define MODELIO_H
+
+#include <QString>
+
+class Lattice;
+
+// read and write model files without a scene: KMC2DData XML, or the binary
+// format (.kmcb) which holds the lattice arrays as stored in memory
+class ModelIO
+{
+public:
+    static bool readXml(const QString &filename, Lattice *lattice, QString *error = 0);
+    static bool writeXml(const QString &filename, const Lattice &lattice, QString *error = 0);
+
+    static bool readBinary(const QString &filename, Lattice *lattice, QString *error = 0);
+    static bool writeBinary(const QString &filename, const Lattice &lattice, QString *error = 0);
+
+    // choose the format from the file contents (read) or the suffix (write)
+    static bool isBinary(const QString &filename);
+    static bool read(const QString &filename, Lattice *lattice, QString *error = 0);
+    static bool write(const QString &filename, const Lattice &lattice, QString *error = 0);
+
+    // site import from coordinate lists (no transitions), streamed in one pass:
+    //   .xyz - count, comment, then "element x y z [energy [occ]]" lines;
+    //          an extended XYZ Lattice="..." comment gives the cell
+    //   other - CSV (comma, semicolon or space separated) "x y [energy [occ]]"
+    //          with an optional header naming the columns (x, y, z, energy or
+    //          en, occ or occupation) and an optional "# cell X Y" comment
+    // coordinates are multiplied by scale (scene units per file unit, which
+    // is 1/KmcEngine::lengthScale for files in Angstrom) and wrapped into the
+    // cell, which must scale to whole scene units; without a cell the sites'
+    // bounding box is used
+    static bool importPoints(const QString &filename, Lattice *lattice, double scale,
+                             QString *error = 0);
+
+    static const quint32 binaryVersion = 1;
+};
+
+#endif // MODELIO_H
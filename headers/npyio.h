@@ -0,0 +1,79 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef NPYIO_H
+#define NPYIO_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+// NumPy array files, read directly by numpy.load: a .npy file holds one
+// float64 array in native byte order, a .npz archive holds named .npy
+// arrays (stored uncompressed)
+
+// a one dimensional .npy array written in blocks as the values arrive: the
+// header has room for any length and is completed on close
+class NpyFile
+{
+public:
+    NpyFile();
+    ~NpyFile();
+
+    // keep > 0 continues an existing file after its first keep values
+    bool open(const QString &filename, qint64 keep = 0, QString *error = 0);
+    void append(double value);
+    void flush(); // write the buffered values
+    bool close(QString *error = 0);
+    bool isOpen() const { return m_file.isOpen(); }
+    qint64 count() const { return m_count; }
+    QString fileName() const { return m_file.fileName(); }
+
+    static QByteArray header(qint64 count); // fixed 128 bytes
+
+private:
+    enum { BlockSize = 65536 };
+
+    QFile m_file;
+    QVector<double> m_block;
+    qint64 m_count;
+    bool m_failed;
+};
+
+// .npz archive: a zip file with one stored name.npy entry per array
+class NpzWriter
+{
+public:
+    NpzWriter();
+    ~NpzWriter();
+
+    bool open(const QString &filename, QString *error = 0);
+    bool addArray(const QString &name, const QVector<double> &values);
+    bool addFile(const QString &name, const QString &npyFile); // copied in blocks
+    bool close(QString *error = 0); // writes the zip directory
+
+private:
+    struct Entry
+    {
+        QByteArray name;
+        quint32 crc;
+        quint32 size;
+        quint32 offset;
+    };
+
+    bool beginEntry(const QString &name);
+    void addData(const char *data, qint64 size);
+    bool endEntry();
+
+    QFile m_file;
+    QVector<Entry> m_entries;
+    bool m_failed;
+};
+
+#endif // NPYIO_H
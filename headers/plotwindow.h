@@ -15,13 +15,14 @@
 #include <QLineEdit>
 #include <qcustomplot.h>
 
+class SeriesRecorder;
+
 class PlotWindow : public QWidget   // plotting graph for simulation output
 {
     Q_OBJECT
 
 public:
-    PlotWindow(QVector<double> *e1, QVector<double> *t1,
-               QVector<double> *x1, QVector<double> *y1, QVector<double> *s1);
+    explicit PlotWindow(const SeriesRecorder *series); // plots a copy of the recorded series
 
 private slots:
     void saveButtonPress();
@@ -36,11 +37,11 @@ private:
     QComboBox *plotType;
     QCustomPlot *customPlot;
 
-    QVector<double> *time;
-    QVector<double> *energy;
-    QVector<double> *xDisp;
-    QVector<double> *yDisp;
-    QVector<double> *sDisp;
+    QVector<double> time;
+    QVector<double> energy;
+    QVector<double> xDisp;
+    QVector<double> yDisp;
+    QVector<double> sDisp;
 };
 
 #endif // PLOTWINDOW_H
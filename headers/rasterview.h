@@ -0,0 +1,89 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef RASTERVIEW_H
+#define RASTERVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QHash>
+#include <QImage>
+#include <QVector>
+
+class Lattice;
+
+// view of the lattice core for models too large for one scene item per
+// site: the sites are drawn as discs into image tiles cached for each zoom
+// level, and once a tile exists only the pixels of the sites that changed
+// since the last frame are drawn again
+class RasterView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    enum ColorMode { Occupation, SiteEnergy };
+
+    explicit RasterView(QWidget *parent = 0);
+
+    void setLattice(const Lattice &lattice); // copies the geometry, energies and occupation
+    void setSite(int i, bool occ); // drawn at the next refresh
+    void setHighlight(int i); // -1 for none
+    void refresh(); // invalidate the regions of the sites changed since the last refresh
+    void setColorMode(ColorMode mode);
+    void setZoom(int level, double scale); // zoom slider value and scene to pixel scale
+
+    int siteCount() const { return m_occ.size(); }
+
+protected:
+    void paintEvent(QPaintEvent *event) Q_DECL_OVERRIDE;
+    void resizeEvent(QResizeEvent *event) Q_DECL_OVERRIDE;
+    void scrollContentsBy(int dx, int dy) Q_DECL_OVERRIDE;
+
+private:
+    enum { TileSize = 256, MaxTiles = 192 };
+
+    QImage *tile(int tx, int ty); // cached or drawn from scratch
+    quint64 tileKey(int tx, int ty) const; // zoom level in the top 16 bits
+    void drawArea(QImage *image, QPainter *painter, const QRect &area, int left, int top) const;
+    void drawSite(QImage *image, QPainter *painter, int i, int left, int top, const QRect &clip) const;
+    void flushChanges();
+    void clearTiles();
+    void updateScrollBars();
+    QPoint origin() const; // viewport position of the cell corner
+    QRect siteRect(int i) const; // pixels covered by site i in cell coordinates
+    QRgb color(int i) const;
+
+    // site copy: the simulation lattice belongs to the worker while it runs
+    int m_xcell;
+    int m_ycell;
+    QVector<float> m_x;
+    QVector<float> m_y;
+    QVector<float> m_en;
+    QVector<char> m_occ;
+    float m_minEn;
+    float m_maxEn;
+    int m_highlight;
+    ColorMode m_mode;
+
+    // sites binned on a scene grid so a tile only visits the sites it covers
+    double m_binSize;
+    int m_nbx;
+    int m_nby;
+    QVector<int> m_binOffset;
+    QVector<int> m_binSites;
+
+    int m_level; // zoom slider value: the tile cache key
+    double m_scale;
+    int m_width; // cell size in pixels
+    int m_height;
+    QHash<quint64, QImage> m_tiles;
+    QVector<int> m_changed; // sites to repaint in the cached tiles
+    int m_refreshed; // changed sites already invalidated
+};
+
+#endif // RASTERVIEW_H
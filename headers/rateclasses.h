@@ -0,0 +1,61 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef RATECLASSES_H
+#define RATECLASSES_H
+
+#include <QHash>
+#include <QVector>
+
+#include "eventselector.h"
+
+// composition (partial-sum) selection over classes of events with equal rate
+// a rate is a function of the barrier and prefactor only, so models with a
+// few distinct (barrier, prefactor) pairs have a few classes: selection is
+// O(number of classes) to find the class plus O(1) within it, and moving an
+// event between classes is O(1); a class is dropped as soon as it empties, so
+// the scan only covers the rates currently present
+class RateClassSelector : public EventSelector
+{
+public:
+    RateClassSelector();
+
+    Type type() const Q_DECL_OVERRIDE { return RateClass; }
+    void resize(int n) Q_DECL_OVERRIDE;
+    int size() const Q_DECL_OVERRIDE { return m_rate.size(); }
+    void setRates(const QVector<double> &rates) Q_DECL_OVERRIDE;
+    void setRate(int i, double rate) Q_DECL_OVERRIDE;
+    double rate(int i) const Q_DECL_OVERRIDE { return m_rate[i]; }
+    double total() const Q_DECL_OVERRIDE;
+    int select(double ran) const Q_DECL_OVERRIDE;
+    QVector<quint64> state() const Q_DECL_OVERRIDE; // scan order and member order
+    bool setState(const QVector<quint64> &state) Q_DECL_OVERRIDE;
+
+    int classCount() const { return m_active.size(); }
+
+private:
+    int classOf(double rate);
+    void removeClass(int c);
+
+    QVector<double> m_rate; // rate of every event
+    QVector<int> m_class; // class of every event (-1 if the rate is zero)
+    QVector<int> m_slot; // position of every event in its class member list
+
+    QVector<double> m_classRate; // the rate shared by the class members
+    QVector<QVector<int> > m_members; // events in each class
+    QHash<quint64, int> m_classIndex; // rate bit pattern -> class
+    QVector<int> m_active; // non-empty classes in scan order
+    QVector<int> m_activeSlot; // position of every class in the scan (-1 if free)
+    QVector<int> m_free; // emptied classes for reuse
+
+    mutable double m_total;
+    mutable bool m_totalValid;
+};
+
+#endif // RATECLASSES_H
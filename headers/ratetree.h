@@ -0,0 +1,41 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef RATETREE_H
+#define RATETREE_H
+
+#include <QVector>
+
+#include "eventselector.h"
+
+// binary sum tree over a set of event rates
+// O(log n) rate update and O(log n) rate-weighted selection
+class RateTree : public EventSelector
+{
+public:
+    RateTree();
+
+    Type type() const Q_DECL_OVERRIDE { return Tree; }
+    void resize(int n) Q_DECL_OVERRIDE; // n events, all with zero rate
+    int size() const Q_DECL_OVERRIDE { return m_size; }
+    void setRates(const QVector<double> &rates) Q_DECL_OVERRIDE; // bulk set in O(n)
+    void setRate(int i, double rate) Q_DECL_OVERRIDE;
+    double rate(int i) const Q_DECL_OVERRIDE { return m_tree[m_leaves + i]; }
+    double total() const Q_DECL_OVERRIDE { return m_tree[1]; }
+    int select(double ran) const Q_DECL_OVERRIDE; // ran uniform on (0,1], -1 if the total is zero
+
+private:
+    void build();
+
+    int m_size; // number of events
+    int m_leaves; // first leaf node (power of two)
+    QVector<double> m_tree; // node i has children 2i and 2i+1, root at 1
+};
+
+#endif // RATETREE_H
@@ -0,0 +1,102 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <QVector>
+
+// 64-bit pseudo random number generator owned by a simulation
+// each generator can be split into independent streams, so that parallel
+// replicas started from the same seed never share random numbers
+class RandomGenerator
+{
+public:
+    enum Type { Xoshiro256, Pcg64, Philox };
+
+    virtual ~RandomGenerator() {}
+
+    virtual Type type() const = 0;
+    virtual void seed(quint64 seed, quint64 stream = 0) = 0;
+    virtual quint64 next() = 0;
+    virtual void jump() = 0; // skip ahead to the start of the next stream
+
+    // the complete generator state, for exact restarts
+    virtual QVector<quint64> state() const = 0;
+    virtual bool setState(const QVector<quint64> &state) = 0; // false if malformed
+
+    // 53-bit uniform double on (0,1]: never exactly zero
+    double uniform() { return ((next() >> 11) + 1)*(1.0/9007199254740992.0); }
+
+    static RandomGenerator *create(Type type);
+};
+
+// xoshiro256** (Blackman and Vigna): jump() advances 2^128 numbers and
+// stream n starts n jumps in, reached in O(log n) matrix products
+class XoshiroGenerator : public RandomGenerator
+{
+public:
+    XoshiroGenerator() { seed(0); }
+
+    Type type() const Q_DECL_OVERRIDE { return Xoshiro256; }
+    void seed(quint64 seed, quint64 stream = 0) Q_DECL_OVERRIDE;
+    quint64 next() Q_DECL_OVERRIDE;
+    void jump() Q_DECL_OVERRIDE;
+    QVector<quint64> state() const Q_DECL_OVERRIDE;
+    bool setState(const QVector<quint64> &state) Q_DECL_OVERRIDE;
+
+private:
+    quint64 m_s[4];
+};
+
+// PCG64 (O'Neill, XSL RR 128/64): a stream is an LCG increment,
+// jump() advances 2^64 numbers
+class PcgGenerator : public RandomGenerator
+{
+public:
+    PcgGenerator() { seed(0); }
+
+    Type type() const Q_DECL_OVERRIDE { return Pcg64; }
+    void seed(quint64 seed, quint64 stream = 0) Q_DECL_OVERRIDE;
+    quint64 next() Q_DECL_OVERRIDE;
+    void jump() Q_DECL_OVERRIDE;
+    QVector<quint64> state() const Q_DECL_OVERRIDE;
+    bool setState(const QVector<quint64> &state) Q_DECL_OVERRIDE;
+
+private:
+    void advance(quint64 deltaHi, quint64 deltaLo);
+
+    quint64 m_stateHi, m_stateLo;
+    quint64 m_incHi, m_incLo;
+};
+
+// Philox4x64-10 (Salmon et al.): counter based, a stream is the second key
+// word and jump() steps the upper half of the counter (2^130 numbers)
+class PhiloxGenerator : public RandomGenerator
+{
+public:
+    PhiloxGenerator() { seed(0); }
+
+    Type type() const Q_DECL_OVERRIDE { return Philox; }
+    void seed(quint64 seed, quint64 stream = 0) Q_DECL_OVERRIDE;
+    quint64 next() Q_DECL_OVERRIDE;
+    void jump() Q_DECL_OVERRIDE;
+    QVector<quint64> state() const Q_DECL_OVERRIDE;
+    bool setState(const QVector<quint64> &state) Q_DECL_OVERRIDE;
+
+private:
+    void generate();
+
+    quint64 m_key[2];
+    quint64 m_counter[4];
+    quint64 m_output[4];
+    int m_used; // outputs of the current block already returned
+};
+
+#endif // RNG_H
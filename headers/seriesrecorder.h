@@ -0,0 +1,77 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef SERIESRECORDER_H
+#define SERIESRECORDER_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+class Checkpoint;
+
+// records the observables of every KMC step in constant memory:
+//   the most recent steps are kept at full resolution in a fixed window
+//   older steps are decimated: every stride'th step is kept, and when the
+//   history fills up the stride doubles and every other point is dropped
+//   optionally every step is streamed to a chunked spill file on disk
+class SeriesRecorder
+{
+public:
+    enum Column { Time, Energy, XDisp, YDisp, SqDisp, ColumnCount };
+
+    explicit SeriesRecorder(int window = 100000, int history = 100000);
+    ~SeriesRecorder();
+
+    // time and energy before the step, displacement after it
+    void append(double time, double energy, double xdisp, double ydisp);
+    void clear(); // the spill file, if any, starts again unless a checkpoint is loaded next
+    qint64 count() const { return m_count; } // steps recorded
+
+    // decimated history followed by the full resolution window
+    QVector<double> series(Column column) const;
+
+    // spill file: a header then chunks of rows, each chunk a row count and
+    // one block of doubles per column
+    bool openSpill(const QString &filename, QString *error = 0);
+    bool closeSpill(QString *error = 0); // false if any write failed
+
+    // carry the recorded series through a checkpoint: loading one keeps the
+    // spilled rows of the steps before it
+    void save(Checkpoint *checkpoint) const;
+    void load(const Checkpoint &checkpoint);
+
+    static const char *columnName(Column column); // also the array names of exported files
+    static const quint32 spillVersion = 1;
+
+private:
+    enum { ChunkRows = 65536 };
+
+    void decimate(qint64 index, const double *row);
+    void writeChunk();
+    void cutSpill();
+
+    int m_windowSize;
+    int m_historySize;
+    qint64 m_count;
+    int m_stride;
+
+    QVector<double> m_window[ColumnCount]; // ring buffer of the latest steps
+    int m_head; // oldest entry once the window is full
+    QVector<double> m_history[ColumnCount];
+
+    QFile m_spill;
+    QVector<double> m_chunk[ColumnCount];
+    qint64 m_spillFirst; // step count of the first spilled row
+    qint64 m_spillRows; // rows written or in the chunk
+    qint64 m_spillCut; // step count to cut the spill back to before the next row, or -1
+    bool m_spillFailed;
+};
+
+#endif // SERIESRECORDER_H
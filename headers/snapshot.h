@@ -0,0 +1,75 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <QAtomicInt>
+#include <QVector>
+
+// the simulation state shown by the view: the site occupations arrive with
+// the series chunks, which are never dropped
+struct KmcSnapshot
+{
+    long steps;
+    double time;
+    double energy;
+    bool stalled; // no event was possible
+};
+
+// lock-free triple buffer between one writer and one reader thread:
+// the writer always has a free slot to fill, the reader always gets the
+// latest complete snapshot and frames it is too slow for are overwritten
+class SnapshotBuffer
+{
+public:
+    SnapshotBuffer();
+
+    KmcSnapshot *writeBuffer() { return &m_slots[m_back]; } // writer thread
+    void publish();
+
+    bool read(); // reader thread: true if a new snapshot arrived
+    const KmcSnapshot &front() const { return m_slots[m_front]; }
+
+private:
+    KmcSnapshot m_slots[3];
+    int m_back; // owned by the writer
+    int m_front; // owned by the reader
+    QAtomicInt m_middle; // shared slot index, bit 2 set when it is unread
+};
+
+// time series and changed sites recorded by the worker since the last hand over
+struct SeriesChunk
+{
+    QVector<double> time; // before each step
+    QVector<double> energy;
+    QVector<double> xDisp; // after each step
+    QVector<double> yDisp;
+    QVector<int> sites; // the engine's dirty set at the end of each batch
+    QVector<char> occ; // and the occupation then: later entries win
+};
+
+// lock-free single-producer single-consumer queue of series chunks
+// nothing is dropped: a full queue leaves the chunk with the producer
+class ChunkQueue
+{
+public:
+    ChunkQueue();
+
+    bool push(SeriesChunk *chunk); // producer: false if the queue is full
+    SeriesChunk *pop(); // consumer: 0 if the queue is empty
+
+private:
+    enum { Capacity = 64 };
+    SeriesChunk *m_chunks[Capacity];
+    QAtomicInt m_head; // next slot to write
+    QAtomicInt m_tail; // next slot to read
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,107 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef TRAJECTORYREADER_H
+#define TRAJECTORYREADER_H
+
+#include <QFile>
+#include <QVector>
+
+// binary event trajectory (.ktr) layout, native byte order:
+//   header
+//   blocks of a keyframe (occupation, one bit per site in 64 bit words)
+//   followed by keyInterval event records, the last block may be short
+//   index footer: one TrajectoryKey per keyframe
+// keyframe k holds the state after event k*keyInterval, so any event is
+// reached by replaying at most keyInterval records
+struct TrajectoryHeader
+{
+    char magic[8];
+    quint32 byteOrder; // written as 0x01020304
+    quint32 version;
+    qint32 nsites;
+    qint32 ntrans;
+    qint32 keyInterval;
+    qint32 reserved;
+    qint64 step0; // state of keyframe 0
+    double time0;
+    qint64 events; // zero until the trajectory is closed
+    qint64 keyCount;
+    qint64 indexOffset;
+};
+
+// an executed event: the step count and time after it
+struct TrajectoryRecord
+{
+    qint64 step;
+    double time;
+    qint32 trans;
+    qint32 from;
+    qint32 to;
+    qint32 reserved;
+};
+
+struct TrajectoryKey
+{
+    qint64 event;
+    qint64 step;
+    double time;
+    qint64 offset;
+};
+
+Q_STATIC_ASSERT(sizeof(TrajectoryHeader) == 72);
+Q_STATIC_ASSERT(sizeof(TrajectoryRecord) == 32);
+Q_STATIC_ASSERT(sizeof(TrajectoryKey) == 32);
+
+// random access to an event trajectory through a memory map: event 0 is the
+// initial state and event n the state after the n'th recorded step
+class TrajectoryReader
+{
+public:
+    TrajectoryReader();
+    ~TrajectoryReader();
+
+    // a trajectory that was never closed is recovered up to its last whole record
+    bool open(const QString &filename, QString *error = 0);
+    void close();
+    bool isOpen() const { return m_data != 0; }
+
+    int siteCount() const { return m_header.nsites; }
+    int transCount() const { return m_header.ntrans; }
+    int keyInterval() const { return m_header.keyInterval; }
+    qint64 eventCount() const { return m_events; }
+    const TrajectoryRecord &record(qint64 event) const; // 1 <= event <= eventCount()
+    qint64 step(qint64 event) const;
+    double time(qint64 event) const;
+
+    // the last event at or before a step count or simulation time
+    qint64 findStep(qint64 step) const;
+    qint64 findTime(double time) const;
+
+    // occupation after an event, rebuilt from the nearest keyframe
+    void state(qint64 event, QVector<char> *occ) const;
+    // move an occupation from one event to another, listing the sites that
+    // changed: short moves replay records, long ones go through a keyframe
+    void move(qint64 from, qint64 to, QVector<char> *occ, QVector<int> *changed = 0) const;
+
+    static const quint32 version = 1;
+
+private:
+    qint64 keyBytes() const;
+    qint64 blockBytes() const;
+    void readKey(int k, QVector<char> *occ) const;
+
+    QFile m_file;
+    const uchar *m_data;
+    TrajectoryHeader m_header;
+    qint64 m_events;
+    QVector<TrajectoryKey> m_keys;
+};
+
+#endif // TRAJECTORYREADER_H
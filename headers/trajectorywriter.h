@@ -0,0 +1,116 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#ifndef TRAJECTORYWRITER_H
+#define TRAJECTORYWRITER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "trajectoryreader.h"
+
+class Lattice;
+
+// one executed step as seen by the trajectory
+struct TrajectoryStep
+{
+    long step; // step count after the event
+    double time; // simulation time after the event
+    int trans;
+    int from;
+    int to;
+};
+
+// writes a trajectory on its own thread: an XYZ animation of the occupied
+// sites, or (.ktr suffix) the binary event trajectory read by TrajectoryReader
+// the simulation hands over steps in blocks through a bounded queue: the
+// writer replays them on its own copy of the occupation and writes a frame
+// every stride steps, so memory use is fixed however long the run
+class TrajectoryWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum Format { Xyz, Events };
+
+    explicit TrajectoryWriter(QObject *parent = 0);
+    ~TrajectoryWriter();
+
+    // start recording from the current lattice state: the stride applies to
+    // XYZ frames, event trajectories hold every step
+    bool open(const QString &filename, const Lattice &lattice, int stride,
+              long step, double time, QString *error = 0);
+    // continue a trajectory written up to a checkpoint: the file is cut back
+    // to the saved offset, the lattice holds the state after the saved event
+    // count and step is the first step of the recording
+    bool resume(const QString &filename, const Lattice &lattice, int stride,
+                long step, qint64 events, qint64 offset, QString *error = 0);
+    // write out every recorded step: the event count and file length are
+    // what a checkpoint saves to resume from, false if any write failed
+    bool sync(qint64 *events, qint64 *offset);
+    long firstStep() const { return m_step0; }
+    QString fileName() const { return m_file.fileName(); }
+    void setKeyInterval(int events) { m_keyInterval = qMax(1, events); } // used by the next open
+    void record(long step, double time, int trans, int from, int to); // simulation thread
+    // flush the remaining steps and wait for the writer: false if any write failed
+    bool close(QString *error = 0);
+    bool isOpen() const { return m_open; }
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    enum { BlockSize = 4096, MaxBlocks = 16 };
+
+    void begin(const Lattice &lattice, int stride, long step, double time, qint64 events);
+    void submit();
+    void writeFrame(long step, double time);
+    void writeEvent(const TrajectoryStep &entry);
+    void writeKeyframe(long step, double time);
+    bool writeIndex();
+    void flushBuffer();
+
+    bool m_open;
+    Format m_format;
+    int m_keyInterval;
+    int m_stride;
+    long m_step0;
+    double m_time0;
+
+    // simulation side
+    QVector<TrajectoryStep> m_pending;
+
+    // shared
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<QVector<TrajectoryStep> > m_queue;
+    bool m_closing;
+    bool m_syncing;
+    QWaitCondition m_synced;
+
+    // writer side
+    QFile m_file;
+    QVector<char> m_occ;
+    QVector<QByteArray> m_siteLine; // pre-formatted XYZ line of every site
+    int m_natoms;
+    QByteArray m_buffer;
+    qint64 m_events; // events written to the event trajectory
+    bool m_resumed; // the initial frame is already in the file
+    bool m_failed; // a write failed: reported by sync() and close()
+    TrajectoryHeader m_header; // event trajectory header, completed on close
+    QVector<TrajectoryKey> m_index; // every keyframe written so far
+};
+
+#endif // TRAJECTORYWRITER_H
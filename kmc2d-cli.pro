@@ -0,0 +1,14 @@
+QT = core
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = kmc2d-cli
+
+include(kmc2d-core.pri)
+
+SOURCES	   +=   cli.cpp
+
+
+# install
+target.path = /home/tt200/kmc2d/
+INSTALLS += target
@@ -0,0 +1,31 @@
+# simulation core shared by the GUI and the command-line simulator
+INCLUDEPATH += $$PWD/headers
+DEPENDPATH += $$PWD/headers
+VPATH += $$PWD/src $$PWD/headers
+
+HEADERS	   +=   lattice.h \
+    kmcengine.h \
+    eventselector.h \
+    ratetree.h \
+    rateclasses.h \
+    rng.h \
+    modelio.h \
+    trajectorywriter.h \
+    trajectoryreader.h \
+    checkpoint.h \
+    seriesrecorder.h \
+    npyio.h \
+    latticegenerator.h
+SOURCES	   +=   lattice.cpp \
+    kmcengine.cpp \
+    eventselector.cpp \
+    ratetree.cpp \
+    rateclasses.cpp \
+    rng.cpp \
+    modelio.cpp \
+    trajectorywriter.cpp \
+    trajectoryreader.cpp \
+    checkpoint.cpp \
+    seriesrecorder.cpp \
+    npyio.cpp \
+    latticegenerator.cpp
@@ -0,0 +1,42 @@
+QT += widgets svg
+qtHaveModule(printsupport): QT += printsupport
+
+TARGET = kmc2d
+
+include(kmc2d-core.pri)
+
+HEADERS	   +=   mainwindow.h \
+		latsite.h \
+		configscene.h \
+		trans.h \
+    cellsizedialog.h \
+    expanddialog.h \
+    generatordialog.h \
+    connectdialog.h \
+    curvedisplay.h \
+    plotwindow.h \
+    qcustomplot.h \
+    snapshot.h \
+    kmcworker.h \
+    rasterview.h
+SOURCES	   +=   mainwindow.cpp \
+		latsite.cpp \
+		main.cpp \
+		trans.cpp \
+		configscene.cpp \
+    cellsizedialog.cpp \
+    expanddialog.cpp \
+    generatordialog.cpp \
+    connectdialog.cpp \
+    curvedisplay.cpp \
+    plotwindow.cpp \
+    qcustomplot.cpp \
+    snapshot.cpp \
+    kmcworker.cpp \
+    rasterview.cpp
+RESOURCES   =	kmc2d.qrc
+
+
+# install
+target.path = /home/tt200/kmc2d/
+INSTALLS += target
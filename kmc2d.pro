@@ -1,28 +1,9 @@
-QT += widgets svg
-qtHaveModule(printsupport): QT += printsupport
+TEMPLATE = subdirs
 
-HEADERS	    =   mainwindow.h \
-		latsite.h \
-		configscene.h \
-		trans.h \
-    cellsizedialog.h \
-    expanddialog.h \
-    curvedisplay.h \
-    plotwindow.h \
-    qcustomplot.h
-SOURCES	    =   mainwindow.cpp \
-		latsite.cpp \
-		main.cpp \
-		trans.cpp \
-		configscene.cpp \
-    cellsizedialog.cpp \
-    expanddialog.cpp \
-    curvedisplay.cpp \
-    plotwindow.cpp \
-    qcustomplot.cpp
-RESOURCES   =	kmc2d.qrc
+# GUI model constructor and simulator
+gui.file = kmc2d-gui.pro
 
+# headless command-line simulator
+cli.file = kmc2d-cli.pro
 
-# install
-target.path = /home/tt200/kmc2d/
-INSTALLS += target
+SUBDIRS = gui cli
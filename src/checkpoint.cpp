@@ -0,0 +1,195 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "checkpoint.h"
+#include "kmcengine.h"
+#include "lattice.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+static const char checkpointMagic[8] = { 'K', 'M', 'C', '2', 'D', 'C', 'H', 'K' };
+
+static bool checkpointError(QString *error, const QString &message)
+{
+    if(error) *error = message;
+    return false;
+}
+
+// FNV-1a over the transition graph: a cheap check that a restart runs on
+// the model the checkpoint was taken from, not just one of the same size
+static quint64 modelFingerprint(const Lattice &lattice)
+{
+    quint64 hash = 0xcbf29ce484222325ULL;
+    for(int t = 0; t < lattice.transCount(); t++) {
+        qint32 words[4] = { lattice.transStart(t), lattice.transEnd(t),
+                            lattice.transShiftX(t), lattice.transShiftY(t) };
+        const uchar *bytes = reinterpret_cast<const uchar *>(words);
+        for(unsigned b = 0; b < sizeof(words); b++) {
+            hash = (hash ^ bytes[b])*0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+Checkpoint::Checkpoint()
+{
+    m_nsites = 0;
+    m_ntrans = 0;
+    m_model = 0;
+    m_temp = 300.0;
+    m_time = 0.0;
+    m_steps = 0;
+    m_xdisp = 0.0;
+    m_ydisp = 0.0;
+    m_energy = 0.0;
+    m_sinceRebuild = 0;
+    m_ratesValid = false;
+    m_generator = RandomGenerator::Xoshiro256;
+    m_seed = 0;
+    m_stream = 0;
+    m_selector = EventSelector::Tree;
+}
+
+void Checkpoint::capture(const KmcEngine &engine)
+{
+    const Lattice *lattice = engine.lattice();
+    m_nsites = lattice->siteCount();
+    m_ntrans = lattice->transCount();
+    m_model = modelFingerprint(*lattice);
+    m_occ.resize(m_nsites);
+    for(int i = 0; i < m_nsites; i++) {
+        m_occ[i] = lattice->occ(i) ? 1 : 0;
+    }
+
+    m_temp = engine.m_temp;
+    m_time = engine.m_time;
+    m_steps = engine.m_nstep;
+    m_xdisp = engine.m_xdisp;
+    m_ydisp = engine.m_ydisp;
+    m_energy = engine.m_energy;
+    m_sinceRebuild = engine.m_sinceRebuild;
+    m_ratesValid = engine.m_ratesValid;
+
+    m_generator = engine.m_rng->type();
+    m_seed = engine.m_seed;
+    m_stream = engine.m_stream;
+    m_rngState = engine.m_rng->state();
+    m_selector = engine.m_rates->type();
+    m_selectorState = m_ratesValid ? engine.m_rates->state() : QVector<quint64>();
+}
+
+bool Checkpoint::restore(KmcEngine *engine, QString *error) const
+{
+    //everything is checked before the engine is touched, so a failed
+    //restore leaves it as it was
+    Lattice *lattice = engine->lattice();
+    if(lattice->siteCount() != m_nsites || lattice->transCount() != m_ntrans ||
+            modelFingerprint(*lattice) != m_model) {
+        return checkpointError(error, "Error. The checkpoint was taken from a different model");
+    }
+    RandomGenerator *rng = RandomGenerator::create(RandomGenerator::Type(m_generator));
+    bool valid = rng->setState(m_rngState);
+    delete rng;
+    if(!valid) {
+        return checkpointError(error, "Error. Malformed checkpoint: bad generator state");
+    }
+    if(m_ratesValid) {
+        //the selector state only fits the rates it was taken with: try it
+        //on a scratch engine holding the checkpoint occupation
+        Lattice scratch(*lattice);
+        for(int i = 0; i < m_nsites; i++) {
+            scratch.setOcc(i, m_occ[i]);
+        }
+        KmcEngine test(&scratch);
+        test.setTemperature(m_temp);
+        test.setSelector(EventSelector::Type(m_selector));
+        test.buildRates();
+        if(!test.m_rates->setState(m_selectorState)) {
+            return checkpointError(error, "Error. Malformed checkpoint: bad selector state");
+        }
+    }
+
+    for(int i = 0; i < m_nsites; i++) {
+        lattice->setOcc(i, m_occ[i]);
+    }
+    engine->setTemperature(m_temp);
+    engine->setSelector(EventSelector::Type(m_selector));
+    engine->setGenerator(RandomGenerator::Type(m_generator));
+    engine->seedRandom(m_seed, m_stream);
+    engine->m_rng->setState(m_rngState);
+
+    //the rates are a function of the occupation: only the selector's
+    //internal ordering has to be put back
+    engine->invalidateRates();
+    if(m_ratesValid) {
+        engine->buildRates();
+        engine->m_rates->setState(m_selectorState);
+    }
+    engine->m_time = m_time;
+    engine->m_nstep = m_steps;
+    engine->m_xdisp = m_xdisp;
+    engine->m_ydisp = m_ydisp;
+    engine->m_energy = m_energy;
+    engine->m_sinceRebuild = m_sinceRebuild;
+    return true;
+}
+
+bool Checkpoint::write(const QString &filename, QString *error) const
+{
+    QSaveFile file(filename);
+    if (!file.open(QFile::WriteOnly)) {
+        return checkpointError(error, "Error writing checkpoint file");
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_6);
+    out.writeRawData(checkpointMagic, 8);
+    out << version << m_nsites << m_ntrans << m_model << m_occ;
+    out << m_temp << m_time << m_steps << m_xdisp << m_ydisp << m_energy
+        << m_sinceRebuild << m_ratesValid;
+    out << m_generator << m_seed << m_stream << m_rngState << m_selector << m_selectorState;
+    out << m_series << m_counters;
+    if(out.status() != QDataStream::Ok || !file.commit()) {
+        return checkpointError(error, "Error writing checkpoint file");
+    }
+    return true;
+}
+
+bool Checkpoint::read(const QString &filename, QString *error)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly)) {
+        return checkpointError(error, "Error reading checkpoint file");
+    }
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_6);
+    char magic[8];
+    if(in.readRawData(magic, 8) != 8 || memcmp(magic, checkpointMagic, 8) != 0) {
+        return checkpointError(error, "Error. Not a KMC2D checkpoint file");
+    }
+    quint32 fileVersion;
+    in >> fileVersion;
+    if(fileVersion != version) {
+        return checkpointError(error, "Error. Unsupported checkpoint version " + QString::number(fileVersion));
+    }
+    in >> m_nsites >> m_ntrans >> m_model >> m_occ;
+    in >> m_temp >> m_time >> m_steps >> m_xdisp >> m_ydisp >> m_energy
+       >> m_sinceRebuild >> m_ratesValid;
+    in >> m_generator >> m_seed >> m_stream >> m_rngState >> m_selector >> m_selectorState;
+    in >> m_series >> m_counters;
+    if(in.status() != QDataStream::Ok || m_occ.size() != m_nsites ||
+            m_generator < RandomGenerator::Xoshiro256 || m_generator > RandomGenerator::Philox ||
+            m_selector < EventSelector::Tree || m_selector > EventSelector::RateClass) {
+        return checkpointError(error, "Error. Malformed checkpoint file");
+    }
+    return true;
+}
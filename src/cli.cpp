@@ -0,0 +1,439 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "lattice.h"
+#include "kmcengine.h"
+#include "modelio.h"
+#include "latticegenerator.h"
+#include "trajectorywriter.h"
+#include "checkpoint.h"
+#include "seriesrecorder.h"
+#include "npyio.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+// the .npz columns are streamed to one .npy file each and packed at the end
+static QString npyColumnFile(const QString &npz, int column)
+{
+    return npz + "." + SeriesRecorder::columnName(SeriesRecorder::Column(column)) + ".npy";
+}
+
+// a number option that does not parse is an error rather than a silent zero
+static bool toNumber(const QString &text, int *value) { bool ok; *value = text.toInt(&ok); return ok; }
+static bool toNumber(const QString &text, long *value) { bool ok; *value = text.toLong(&ok); return ok; }
+static bool toNumber(const QString &text, quint64 *value) { bool ok; *value = text.toULongLong(&ok); return ok; }
+static bool toNumber(const QString &text, double *value) { bool ok; *value = text.toDouble(&ok); return ok; }
+
+template<typename T>
+static bool optionNumber(const QCommandLineParser &parser, const QCommandLineOption &option, T *value, QTextStream &err)
+{
+    if(toNumber(parser.value(option), value)) return true;
+    err << "kmc2d-cli: invalid --" << option.names().last() << " value " << parser.value(option) << "\n";
+    return false;
+}
+
+// checkpoint the engine together with the length of the data written so far:
+// a restart cuts the files back to this point and carries on appending
+static bool saveCheckpoint(const QString &filename, const KmcEngine &engine, QFile *dataFile,
+                           QTextStream *out, NpyFile *columns, TrajectoryWriter *trajectory, QString *error)
+{
+    Checkpoint checkpoint;
+    checkpoint.capture(engine);
+    if(dataFile->isOpen()) {
+        out->flush();
+        checkpoint.setCounter("output", dataFile->pos());
+    }
+    if(columns[0].isOpen()) {
+        for(int c = 0; c < SeriesRecorder::ColumnCount; c++) columns[c].flush();
+        checkpoint.setCounter("npz.rows", columns[0].count());
+    }
+    if(trajectory->isOpen()) {
+        qint64 events, offset;
+        if(!trajectory->sync(&events, &offset)) {
+            if(error) *error = "Error writing trajectory file " + trajectory->fileName();
+            return false;
+        }
+        checkpoint.setCounter("trajectory.events", events);
+        checkpoint.setCounter("trajectory.offset", offset);
+        checkpoint.setCounter("trajectory.step0", trajectory->firstStep());
+    }
+    return checkpoint.write(filename, error);
+}
+
+// headless simulator: runs a KMC2DData XML model without the GUI
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("kmc2d-cli");
+    QCoreApplication::setApplicationVersion("0.22");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("KMC2D headless lattice kinetic Monte Carlo simulator");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("model", "KMC2DData XML or binary (.kmcb) model file (omitted with --generate or --import).");
+
+    QCommandLineOption tempOption(QStringList() << "t" << "temperature",
+                                  "Simulation temperature (K).", "kelvin", "300");
+    QCommandLineOption seedOption(QStringList() << "s" << "seed",
+                                  "Random number generator seed.", "seed", "123");
+    QCommandLineOption stepsOption(QStringList() << "n" << "steps",
+                                   "Number of KMC steps.", "steps", "1000");
+    QCommandLineOption timeOption(QStringList() << "time-limit",
+                                  "Stop when the simulation time (s) is reached.", "seconds", "0");
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    "Write the time series to this file.", "file");
+    QCommandLineOption npzOption(QStringList() << "npz",
+                                 "Write the time series as a NumPy .npz archive to this file.", "file");
+    QCommandLineOption intervalOption(QStringList() << "interval",
+                                      "Write the time series every N steps.", "N", "1");
+    QCommandLineOption finalOption(QStringList() << "f" << "final",
+                                   "Write the final configuration to this XML or .kmcb file.", "file");
+    QCommandLineOption trajOption(QStringList() << "trajectory",
+                                  "Record an XYZ or event (.ktr) trajectory to this file.", "file");
+    QCommandLineOption strideOption(QStringList() << "stride",
+                                    "Write an XYZ trajectory frame every N steps.", "N", "1");
+    QCommandLineOption keyOption(QStringList() << "keyframe",
+                                 "Write an event trajectory keyframe every N steps.", "N", "10000");
+    QCommandLineOption generateOption(QStringList() << "generate",
+                                      "Generate a square, hexagonal or honeycomb lattice of NX by NY unit cells, "
+                                      "e.g. honeycomb:100x100, instead of reading a model.", "type:NXxNY");
+    QCommandLineOption importOption(QStringList() << "import",
+                                    "Read the sites from a CSV or XYZ coordinate file instead of a model.", "file");
+    QCommandLineOption scaleOption(QStringList() << "import-scale",
+                                   "Scene units per Angstrom of the imported coordinates.", "factor",
+                                   QString::number(1.0/KmcEngine::lengthScale));
+    QCommandLineOption spacingOption(QStringList() << "spacing",
+                                     "Generated nearest-neighbour site spacing.", "distance", "40");
+    QCommandLineOption siteEnOption(QStringList() << "site-energy",
+                                    "Generated site energy (eV).", "eV", "0");
+    QCommandLineOption nnModOption(QStringList() << "nnmod",
+                                   "Generated coordination modifiers 1-6 (eV), comma separated.", "list", "0,0,0,0,0,0");
+    QCommandLineOption barrierOption(QStringList() << "barrier",
+                                     "Generated or connected transition barrier (eV).", "eV", "1");
+    QCommandLineOption prefactorOption(QStringList() << "prefactor",
+                                       "Generated or connected transition prefactor (THz).", "THz", "10");
+    QCommandLineOption coverageOption(QStringList() << "coverage",
+                                      "Fraction of generated sites occupied at random (uses --seed).", "fraction", "0");
+    QCommandLineOption connectOption(QStringList() << "connect",
+                                     "Add transitions between all sites closer than this distance.", "cutoff");
+    QCommandLineOption expandOption(QStringList() << "expand",
+                                    "Replicate the model cell NX by NY times, e.g. 10x10.", "NXxNY");
+    QCommandLineOption convertOption(QStringList() << "convert",
+                                     "Convert the model to this XML or .kmcb file and exit.", "file");
+    QCommandLineOption selectorOption(QStringList() << "selector",
+                                      "Event selection method: tree or class.", "method", "tree");
+    QCommandLineOption rngOption(QStringList() << "rng",
+                                 "Random number generator: xoshiro, pcg or philox.", "generator", "xoshiro");
+    QCommandLineOption streamOption(QStringList() << "stream",
+                                    "Independent random number stream (one per replica).", "N", "0");
+    QCommandLineOption checkpointOption(QStringList() << "checkpoint",
+                                        "Write restart checkpoints to this file.", "file");
+    QCommandLineOption checkIntervalOption(QStringList() << "checkpoint-interval",
+                                           "Write a checkpoint every N steps.", "N", "100000");
+    QCommandLineOption restartOption(QStringList() << "restart",
+                                     "Continue the run saved in this checkpoint (with the same model).", "file");
+    parser.addOption(tempOption);
+    parser.addOption(seedOption);
+    parser.addOption(stepsOption);
+    parser.addOption(timeOption);
+    parser.addOption(outputOption);
+    parser.addOption(npzOption);
+    parser.addOption(intervalOption);
+    parser.addOption(finalOption);
+    parser.addOption(generateOption);
+    parser.addOption(importOption);
+    parser.addOption(scaleOption);
+    parser.addOption(spacingOption);
+    parser.addOption(siteEnOption);
+    parser.addOption(nnModOption);
+    parser.addOption(barrierOption);
+    parser.addOption(prefactorOption);
+    parser.addOption(coverageOption);
+    parser.addOption(connectOption);
+    parser.addOption(expandOption);
+    parser.addOption(convertOption);
+    parser.addOption(trajOption);
+    parser.addOption(strideOption);
+    parser.addOption(keyOption);
+    parser.addOption(selectorOption);
+    parser.addOption(rngOption);
+    parser.addOption(streamOption);
+    parser.addOption(checkpointOption);
+    parser.addOption(checkIntervalOption);
+    parser.addOption(restartOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if(args.size() != (parser.isSet(generateOption) || parser.isSet(importOption) ? 0 : 1)) {
+        err << "kmc2d-cli: exactly one model file, or --generate or --import, is required\n";
+        parser.showHelp(1);
+    }
+
+    double temp, maxTime, scale, spacing, siteEnergy, barrier, prefactor, coverage;
+    long maxSteps, checkInterval;
+    int interval, stride, keyInterval;
+    quint64 seed, stream;
+    if(!optionNumber(parser, tempOption, &temp, err) || !optionNumber(parser, stepsOption, &maxSteps, err) ||
+            !optionNumber(parser, timeOption, &maxTime, err) || !optionNumber(parser, intervalOption, &interval, err) ||
+            !optionNumber(parser, checkIntervalOption, &checkInterval, err) ||
+            !optionNumber(parser, seedOption, &seed, err) || !optionNumber(parser, streamOption, &stream, err) ||
+            !optionNumber(parser, strideOption, &stride, err) || !optionNumber(parser, keyOption, &keyInterval, err) ||
+            !optionNumber(parser, scaleOption, &scale, err) || !optionNumber(parser, spacingOption, &spacing, err) ||
+            !optionNumber(parser, siteEnOption, &siteEnergy, err) || !optionNumber(parser, barrierOption, &barrier, err) ||
+            !optionNumber(parser, prefactorOption, &prefactor, err) ||
+            !optionNumber(parser, coverageOption, &coverage, err)) {
+        return 1;
+    }
+    interval = qMax(1, interval);
+    checkInterval = qMax(1L, checkInterval);
+    if(temp <= 0.0) {
+        err << "kmc2d-cli: temperature must be positive\n";
+        return 1;
+    }
+    QString rng = parser.value(rngOption);
+    if(rng != "xoshiro" && rng != "pcg" && rng != "philox") {
+        err << "kmc2d-cli: unknown random number generator " << rng << "\n";
+        return 1;
+    }
+    QString selector = parser.value(selectorOption);
+    if(selector != "tree" && selector != "class") {
+        err << "kmc2d-cli: unknown selector " << selector << "\n";
+        return 1;
+    }
+
+    Lattice lattice;
+    QString error;
+    if(parser.isSet(generateOption)) {
+        QStringList spec = parser.value(generateOption).split(':');
+        QStringList size = spec.value(1).split('x');
+        QStringList mods = parser.value(nnModOption).split(',');
+        LatticeGenerator generator;
+        LatticeGenerator::Type type;
+        int nx, ny;
+        if(spec.size() != 2 || size.size() != 2 || !LatticeGenerator::typeFromName(spec[0], &type) ||
+                !toNumber(size[0], &nx) || !toNumber(size[1], &ny)) {
+            err << "kmc2d-cli: invalid lattice " << parser.value(generateOption) << "\n";
+            return 1;
+        }
+        generator.setType(type);
+        generator.setSize(nx, ny);
+        generator.setSpacing(spacing);
+        generator.setSiteEnergy(siteEnergy);
+        for(int nn = 1; nn <= 6; nn++) {
+            double mod = 0.0;
+            if(nn <= mods.size() && !toNumber(mods[nn - 1], &mod)) {
+                err << "kmc2d-cli: invalid --nnmod value " << parser.value(nnModOption) << "\n";
+                return 1;
+            }
+            generator.setNNMod(nn, mod);
+        }
+        generator.setBarrier(barrier);
+        generator.setPrefactors(prefactor, prefactor);
+        generator.setCoverage(coverage, seed);
+        if(!generator.generate(&lattice, &error)) {
+            err << "kmc2d-cli: " << error << "\n";
+            return 1;
+        }
+    } else if(parser.isSet(importOption)) {
+        if(!ModelIO::importPoints(parser.value(importOption), &lattice, scale, &error)) {
+            err << "kmc2d-cli: " << parser.value(importOption) << ": " << error << "\n";
+            return 1;
+        }
+    } else if(!ModelIO::read(args.first(), &lattice, &error)) {
+        err << "kmc2d-cli: " << args.first() << ": " << error << "\n";
+        return 1;
+    }
+    if(parser.isSet(connectOption)) {
+        double cutoff;
+        if(!optionNumber(parser, connectOption, &cutoff, err)) return 1;
+        if(!LatticeGenerator::connect(&lattice, cutoff, barrier, prefactor, prefactor, 0, &error)) {
+            err << "kmc2d-cli: " << error << "\n";
+            return 1;
+        }
+    }
+    if(parser.isSet(expandOption)) {
+        QStringList factors = parser.value(expandOption).split('x');
+        int nx, ny;
+        if(factors.size() != 2 || !toNumber(factors[0], &nx) || !toNumber(factors[1], &ny) ||
+                !lattice.expand(nx, ny)) {
+            err << "kmc2d-cli: invalid expansion " << parser.value(expandOption) << "\n";
+            return 1;
+        }
+    }
+    if(parser.isSet(convertOption)) {
+        if(!ModelIO::write(parser.value(convertOption), lattice, &error)) {
+            err << "kmc2d-cli: " << parser.value(convertOption) << ": " << error << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    KmcEngine engine(&lattice);
+    engine.setTemperature(temp);
+    engine.setSelector(selector == "class" ? EventSelector::RateClass : EventSelector::Tree);
+    if(rng == "pcg") engine.setGenerator(RandomGenerator::Pcg64);
+    if(rng == "philox") engine.setGenerator(RandomGenerator::Philox);
+    engine.seedRandom(seed, stream);
+
+    //a restart takes the temperature, generator and selector from the checkpoint
+    Checkpoint restart;
+    if(parser.isSet(restartOption)) {
+        if(!restart.read(parser.value(restartOption), &error) || !restart.restore(&engine, &error)) {
+            err << "kmc2d-cli: " << parser.value(restartOption) << ": " << error << "\n";
+            return 1;
+        }
+    }
+
+    QFile dataFile;
+    QTextStream out;
+    if(parser.isSet(outputOption)) {
+        dataFile.setFileName(parser.value(outputOption));
+        if(restart.hasCounter("output")) {
+            qint64 pos = restart.counter("output");
+            if(!dataFile.open(QFile::ReadWrite) || dataFile.size() < pos ||
+                    !dataFile.resize(pos) || !dataFile.seek(pos)) {
+                err << "kmc2d-cli: error appending to data file " << dataFile.fileName() << "\n";
+                return 1;
+            }
+        } else if(!dataFile.open(QFile::WriteOnly | QFile::Truncate)) {
+            err << "kmc2d-cli: error writing data file " << dataFile.fileName() << "\n";
+            return 1;
+        }
+        out.setDevice(&dataFile);
+        out.setRealNumberPrecision(10);
+        if(!restart.hasCounter("output")) out << "Time Energy xDisp yDisp Sq.Disp\n";
+    }
+
+    NpyFile columns[SeriesRecorder::ColumnCount];
+    QString npz = parser.value(npzOption);
+    if(!npz.isEmpty()) {
+        if(parser.isSet(restartOption) && !restart.hasCounter("npz.rows")) {
+            err << "kmc2d-cli: " << npz << ": the checkpoint has no array rows to continue from\n";
+            return 1;
+        }
+        for(int c = 0; c < SeriesRecorder::ColumnCount; c++) {
+            if(!columns[c].open(npyColumnFile(npz, c), restart.counter("npz.rows"), &error)) {
+                err << "kmc2d-cli: " << error << "\n";
+                return 1;
+            }
+        }
+    }
+
+    TrajectoryWriter trajectory;
+    if(parser.isSet(trajOption)) {
+        trajectory.setKeyInterval(keyInterval);
+        bool ok;
+        if(restart.hasCounter("trajectory.offset")) {
+            ok = trajectory.resume(parser.value(trajOption), lattice, stride,
+                                   restart.counter("trajectory.step0"), restart.counter("trajectory.events"),
+                                   restart.counter("trajectory.offset"), &error);
+        } else if(parser.isSet(restartOption) && QFile::exists(parser.value(trajOption))) {
+            //never overwrite the steps recorded before the checkpoint
+            ok = false;
+            error = "the checkpoint has no trajectory to continue from";
+        } else {
+            ok = trajectory.open(parser.value(trajOption), lattice, stride,
+                                 engine.steps(), engine.time(), &error);
+        }
+        if(!ok) {
+            err << "kmc2d-cli: " << parser.value(trajOption) << ": " << error << "\n";
+            return 1;
+        }
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    engine.prepareRates();
+    while(engine.steps() < maxSteps && (maxTime <= 0.0 || engine.time() < maxTime)) {
+        double stepTime = engine.time();
+        double stepEnergy = engine.energy();
+        KmcEvent event;
+        if(!engine.step(&event)) {
+            err << "kmc2d-cli: no transitions available after " << engine.steps() << " steps\n";
+            break;
+        }
+        if(trajectory.isOpen()) {
+            trajectory.record(engine.steps(), engine.time(), event.trans, event.from, event.to);
+        }
+        if(engine.steps() % interval == 0) {
+            double xd = engine.xDisplacement();
+            double yd = engine.yDisplacement();
+            if(dataFile.isOpen()) {
+                out << stepTime << " " << stepEnergy << " " << xd << " " << yd << " " << xd*xd + yd*yd << "\n";
+            }
+            if(columns[0].isOpen()) {
+                columns[SeriesRecorder::Time].append(stepTime);
+                columns[SeriesRecorder::Energy].append(stepEnergy);
+                columns[SeriesRecorder::XDisp].append(xd);
+                columns[SeriesRecorder::YDisp].append(yd);
+                columns[SeriesRecorder::SqDisp].append(xd*xd + yd*yd);
+            }
+        }
+        if(parser.isSet(checkpointOption) && engine.steps() % checkInterval == 0) {
+            if(!saveCheckpoint(parser.value(checkpointOption), engine, &dataFile, &out, columns, &trajectory, &error)) {
+                err << "kmc2d-cli: " << parser.value(checkpointOption) << ": " << error << "\n";
+                return 1;
+            }
+        }
+    }
+    //the trajectory is synced for the checkpoint before its index is appended
+    if(parser.isSet(checkpointOption)) {
+        if(!saveCheckpoint(parser.value(checkpointOption), engine, &dataFile, &out, columns, &trajectory, &error)) {
+            err << "kmc2d-cli: " << parser.value(checkpointOption) << ": " << error << "\n";
+            return 1;
+        }
+    }
+    if(!trajectory.close(&error)) {
+        err << "kmc2d-cli: " << error << "\n";
+        return 1;
+    }
+    qint64 elapsed = clock.elapsed();
+
+    if(dataFile.isOpen()) {
+        out.flush();
+        dataFile.close();
+    }
+    if(columns[0].isOpen()) {
+        NpzWriter archive;
+        bool ok = archive.open(npz, &error);
+        for(int c = 0; c < SeriesRecorder::ColumnCount; c++) {
+            ok = columns[c].close(&error) && ok;
+            if(ok) ok = archive.addFile(SeriesRecorder::columnName(SeriesRecorder::Column(c)), columns[c].fileName());
+        }
+        if(ok) ok = archive.close(&error);
+        if(!ok) {
+            err << "kmc2d-cli: " << npz << ": " << error << "\n";
+            return 1;
+        }
+        //the column files stay behind while a checkpoint may still continue them
+        if(!parser.isSet(checkpointOption)) {
+            for(int c = 0; c < SeriesRecorder::ColumnCount; c++) QFile::remove(columns[c].fileName());
+        }
+    }
+    if(parser.isSet(finalOption)) {
+        if(!ModelIO::write(parser.value(finalOption), lattice, &error)) {
+            err << "kmc2d-cli: " << parser.value(finalOption) << ": " << error << "\n";
+            return 1;
+        }
+    }
+
+    QTextStream info(stdout);
+    info << "steps " << engine.steps() << " time " << engine.time() << " s"
+         << " wall " << elapsed << " ms";
+    if(elapsed > 0) info << " (" << engine.steps()*1000.0/elapsed << " steps/s)";
+    info << "\n";
+
+    return 0;
+}
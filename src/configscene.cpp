@@ -9,6 +9,7 @@
 
 #include "configscene.h"
 #include "trans.h"
+#include "lattice.h"
 
 #include <QTextCursor>
 #include <QGraphicsSceneMouseEvent>
@@ -29,15 +30,13 @@ ConfigScene::ConfigScene(QMenu *siteMenu, QMenu *transMenu, int xc, int yc, QObj
     ycell = yc;
     indx = 1;
     snap = false;
+    imageMargin = 100.0;
 }
 
-void ConfigScene::addSite(bool ostate,double en, double xc, double yc, int sindx, int xrep, int yrep,
+Site *ConfigScene::addSite(bool ostate,double en, double xc, double yc, int sindx, int xrep, int yrep,
                           double m1, double m2, double m3, double m4, double m5, double m6)
 {
     Site *item;
-    //periodic images
-    Site *image1, *image2, *image3, *image4;
-    Site *image5, *image6, *image7, *image8;
 
     //insert objects into scene
     item = new Site(0,0,mySiteMenu);
@@ -50,88 +49,73 @@ void ConfigScene::addSite(bool ostate,double en, double xc, double yc, int sindx
     item->setID(sindx);
     item->setRep(xrep,yrep);
     item->setNNMod(m1,m2,m3,m4,m5,m6);
-    QPointF xper1(0,ycell), xper2(xcell,ycell), xper3(xcell,0), xper4(xcell,-ycell);
-    QPointF xper5(0,-ycell), xper6(-xcell,-ycell), xper7(-xcell,0), xper8(-xcell,ycell);
-    image1 = new Site(0,1,mySiteMenu);
-    image2 = new Site(0,2,mySiteMenu);
-    image3 = new Site(0,3,mySiteMenu);
-    image4 = new Site(0,4,mySiteMenu);
-    image5 = new Site(0,5,mySiteMenu);
-    image6 = new Site(0,6,mySiteMenu);
-    image7 = new Site(0,7,mySiteMenu);
-    image8 = new Site(0,8,mySiteMenu);
-    image1->setNNMod(m1,m2,m3,m4,m5,m6);
-    image2->setNNMod(m1,m2,m3,m4,m5,m6);
-    image3->setNNMod(m1,m2,m3,m4,m5,m6);
-    image4->setNNMod(m1,m2,m3,m4,m5,m6);
-    image5->setNNMod(m1,m2,m3,m4,m5,m6);
-    image6->setNNMod(m1,m2,m3,m4,m5,m6);
-    image7->setNNMod(m1,m2,m3,m4,m5,m6);
-    image8->setNNMod(m1,m2,m3,m4,m5,m6);
-    if(ostate){
-        image1->on();
-        image2->on();
-        image3->on();
-        image4->on();
-        image5->on();
-        image6->on();
-        image7->on();
-        image8->on();
-    } else {
-        image1->off();
-        image2->off();
-        image3->off();
-        image4->off();
-        image5->off();
-        image6->off();
-        image7->off();
-        image8->off();
-    }
-    image1->setID(sindx);
-    image2->setID(sindx);
-    image3->setID(sindx);
-    image4->setID(sindx);
-    image5->setID(sindx);
-    image6->setID(sindx);
-    image7->setID(sindx);
-    image8->setID(sindx);
-    image1->setEn(en);
-    image2->setEn(en);
-    image3->setEn(en);
-    image4->setEn(en);
-    image5->setEn(en);
-    image6->setEn(en);
-    image7->setEn(en);
-    image8->setEn(en);
-    image1->setRep(xrep,yrep);
-    image2->setRep(xrep,yrep);
-    image3->setRep(xrep,yrep);
-    image4->setRep(xrep,yrep);
-    image5->setRep(xrep,yrep);
-    image6->setRep(xrep,yrep);
-    image7->setRep(xrep,yrep);
-    image8->setRep(xrep,yrep);
-    image1->setParentItem(item);
-    image2->setParentItem(item);
-    image3->setParentItem(item);
-    image4->setParentItem(item);
-    image5->setParentItem(item);
-    image6->setParentItem(item);
-    image7->setParentItem(item);
-    image8->setParentItem(item);
     addItem(item);
     item->setPos(xc,yc);
-    image1->setPos(xper1);
-    image2->setPos(xper2);
-    image3->setPos(xper3);
-    image4->setPos(xper4);
-    image5->setPos(xper5);
-    image6->setPos(xper6);
-    image7->setPos(xper7);
-    image8->setPos(xper8);
+    updateImages(item);
+    return item;
+}
+
+//a periodic image (numbered as in Lattice::imageShift) with the site's properties
+Site *ConfigScene::addImage(Site *site, int img)
+{
+    Site *image = new Site(0,img,mySiteMenu);
+    image->setNNMod(site->nnMod(1),site->nnMod(2),site->nnMod(3),site->nnMod(4),site->nnMod(5),site->nnMod(6));
+    if(site->stat()){
+        image->on();
+    } else {
+        image->off();
+    }
+    image->setID(site->id());
+    image->setEn(site->en());
+    image->setRep(site->xr(),site->yr());
+    image->setParentItem(site);
+    int sx, sy;
+    Lattice::imageShift(img, &sx, &sy);
+    image->setPos(sx*xcell, sy*ycell);
+    return image;
 }
 
-void ConfigScene::addTrans(Site *myStartItem, Site *myEndItem, double nbar, int id, double startPF, double endPF)
+Site *ConfigScene::siteImage(Site *site, int sx, int sy)
+{
+    if(sx == 0 && sy == 0) return site;
+    foreach (QGraphicsItem *child, site->childItems()) {
+        Site *image = qgraphicsitem_cast<Site *>(child);
+        int isx, isy;
+        image->cellShift(&isx, &isy);
+        if(isx == sx && isy == sy) return image;
+    }
+    for(int img = 1; img < 9; img++) {
+        int isx, isy;
+        Lattice::imageShift(img, &isx, &isy);
+        if(isx == sx && isy == sy) return addImage(site, img);
+    }
+    return 0;
+}
+
+void ConfigScene::updateImages(Site *site)
+{
+    bool shown[9] = { false };
+    foreach (QGraphicsItem *child, site->childItems()) {
+        Site *image = qgraphicsitem_cast<Site *>(child);
+        int sx, sy;
+        image->cellShift(&sx, &sy);
+        image->setPos(sx*xcell, sy*ycell);
+        shown[image->img()] = true;
+    }
+    for(int img = 1; img < 9; img++) {
+        if(shown[img]) continue;
+        int sx, sy;
+        Lattice::imageShift(img, &sx, &sy);
+        double ximg = site->x() + sx*xcell;
+        double yimg = site->y() + sy*ycell;
+        if(ximg >= -imageMargin && ximg <= xcell + imageMargin &&
+                yimg >= -imageMargin && yimg <= ycell + imageMargin) {
+            addImage(site, img);
+        }
+    }
+}
+
+Transition *ConfigScene::addTrans(Site *myStartItem, Site *myEndItem, double nbar, int id, double startPF, double endPF)
 {
     Transition *transition = new Transition(myTransMenu, myStartItem, myEndItem);
     transition->setColor(myLineColor);
@@ -148,6 +132,7 @@ void ConfigScene::addTrans(Site *myStartItem, Site *myEndItem, double nbar, int
             this, SIGNAL(itemdeSelected(QGraphicsItem*)));
     addItem(transition);
     transition->updatePosition();
+    return transition;
 }
 
 void ConfigScene::addTransPair(Site *myStartItem1, Site *myEndItem1,Site *myStartItem2, Site *myEndItem2, double nbar)
@@ -193,111 +178,21 @@ void ConfigScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
     if (mouseEvent->button() != Qt::LeftButton)
         return;
 
-    Site *item;
-
-    //periodic images
-    Site *image1, *image2, *image3, *image4;
-    Site *image5, *image6, *image7, *image8;
-
     //insert objects into scene
     switch (myMode) {
         case InsertUSite:
+        case InsertSite:
             if(mouseEvent->scenePos().x() > sceneRect().left() &&
                     mouseEvent->scenePos().x() < sceneRect().right() &&
                     mouseEvent->scenePos().y() > sceneRect().top() &&
                     mouseEvent->scenePos().y() < sceneRect().bottom())
             {
-                item = new Site(0,0,mySiteMenu);
-                item->off(); // set to unoccupied
-                QPointF xper1(0,ycell), xper2(xcell,ycell), xper3(xcell,0), xper4(xcell,-ycell);
-                QPointF xper5(0,-ycell), xper6(-xcell,-ycell), xper7(-xcell,0), xper8(-xcell,ycell);
-                // add the periodic images
-                image1 = new Site(0,1,mySiteMenu);
-                image1->off();
-                image1->setParentItem(item);
-                image2 = new Site(0,2,mySiteMenu);
-                image2->off();
-                image2->setParentItem(item);
-                image3 = new Site(0,3,mySiteMenu);
-                image3->off();
-                image3->setParentItem(item);
-                image4 = new Site(0,4,mySiteMenu);
-                image4->off();
-                image4->setParentItem(item);
-                image5 = new Site(0,5,mySiteMenu);
-                image5->off();
-                image5->setParentItem(item);
-                image6 = new Site(0,6,mySiteMenu);
-                image6->off();
-                image6->setParentItem(item);
-                image7 = new Site(0,7,mySiteMenu);
-                image7->off();
-                image7->setParentItem(item);
-                image8 = new Site(0,8,mySiteMenu);
-                image8->off();
-                image8->setParentItem(item);
-                addItem(item);
-                item->setPos(mouseEvent->scenePos());
-                image1->setPos(xper1);
-                image2->setPos(xper2);
-                image3->setPos(xper3);
-                image4->setPos(xper4);
-                image5->setPos(xper5);
-                image6->setPos(xper6);
-                image7->setPos(xper7);
-                image8->setPos(xper8);
+                //occupied or unoccupied, with the periodic images near the edges
+                addSite(myMode == InsertSite, 0.0, mouseEvent->scenePos().x(), mouseEvent->scenePos().y(),
+                        0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
             }
             break;
 
-    case InsertSite:
-        if(mouseEvent->scenePos().x() > sceneRect().left() &&
-                mouseEvent->scenePos().x() < sceneRect().right() &&
-                mouseEvent->scenePos().y() > sceneRect().top() &&
-                mouseEvent->scenePos().y() < sceneRect().bottom())
-        {
-
-            item = new Site(0,0,mySiteMenu);
-            item->on(); //set to occupied
-            QPointF xper1(0,ycell), xper2(xcell,ycell), xper3(xcell,0), xper4(xcell,-ycell);
-            QPointF xper5(0,-ycell), xper6(-xcell,-ycell), xper7(-xcell,0), xper8(-xcell,ycell);
-            // add the periodic images
-            image1 = new Site(0,1,mySiteMenu);
-            image1->on();
-            image1->setParentItem(item);
-            image2 = new Site(0,2,mySiteMenu);
-            image2->on();
-            image2->setParentItem(item);
-            image3 = new Site(0,3,mySiteMenu);
-            image3->on();
-            image3->setParentItem(item);
-            image4 = new Site(0,4,mySiteMenu);
-            image4->on();
-            image4->setParentItem(item);
-            image5 = new Site(0,5,mySiteMenu);
-            image5->on();
-            image5->setParentItem(item);
-            image6 = new Site(0,6,mySiteMenu);
-            image6->on();
-            image6->setParentItem(item);
-            image7 = new Site(0,7,mySiteMenu);
-            image7->on();
-            image7->setParentItem(item);
-            image8 = new Site(0,8,mySiteMenu);
-            image8->on();
-            image8->setParentItem(item);
-            addItem(item);
-            item->setPos(mouseEvent->scenePos());
-            image1->setPos(xper1);
-            image2->setPos(xper2);
-            image3->setPos(xper3);
-            image4->setPos(xper4);
-            image5->setPos(xper5);
-            image6->setPos(xper6);
-            image7->setPos(xper7);
-            image8->setPos(xper8);
-        }
-        break;
-
         case InsertTrans:
             line = new QGraphicsLineItem(QLineF(mouseEvent->scenePos(),
                                         mouseEvent->scenePos()));
@@ -309,6 +204,8 @@ void ConfigScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
         ;
     }
     QGraphicsScene::mousePressEvent(mouseEvent);
+    if (myMode == InsertUSite || myMode == InsertSite)
+        emit modelChanged();
 }
 
 void ConfigScene::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
@@ -376,26 +273,11 @@ void ConfigScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
                 addItem(transition);
                 transition->updatePosition();
 
-                //get the image and opposite image
-                int image = endItem->img();
-                int opimage;
-                if(image == 1) opimage = 5;
-                if(image == 2) opimage = 6;
-                if(image == 3) opimage = 7;
-                if(image == 4) opimage = 8;
-                if(image == 5) opimage = 1;
-                if(image == 6) opimage = 2;
-                if(image == 7) opimage = 3;
-                if(image == 8) opimage = 4;
-
-                //mirror transition
-                Site *startImage;
-                Site *endImage;
-                foreach (QGraphicsItem *item, startItem->childItems()) {
-                    startImage = qgraphicsitem_cast<Site *>(item);
-                    if(startImage->img() == opimage) break;
-                }
-                endImage = qgraphicsitem_cast<Site *>(endItem->parentItem());
+                //the mirror starts from the opposite image of the start site
+                int sx, sy;
+                endItem->cellShift(&sx, &sy);
+                Site *startImage = siteImage(startItem, -sx, -sy);
+                Site *endImage = qgraphicsitem_cast<Site *>(endItem->parentItem());
 
                 //mirror transition
                 Transition *mtransition = new Transition(myTransMenu, startImage, endImage);
@@ -417,6 +299,15 @@ void ConfigScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
 
     line = 0;
     QGraphicsScene::mouseReleaseEvent(mouseEvent);
+
+    //moved sites show the images they now need near the edges
+    if (myMode == MoveItem) {
+        foreach (QGraphicsItem *item, selectedItems()) {
+            if (item->type() == Site::Type)
+                updateImages(qgraphicsitem_cast<Site *>(item));
+        }
+    }
+    emit modelChanged();
 }
 
 bool ConfigScene::isItemChange(int type)
@@ -586,3 +477,105 @@ void ConfigScene::setEndPreFac(double pf)
         }
     }
 }
+
+// build the flat simulation lattice from the scene items
+// sites and transitions receive the scene item for each lattice index
+void ConfigScene::buildLattice(Lattice *lattice, QVector<Site *> *sites, QVector<Transition *> *transitions)
+{
+    lattice->clear();
+    lattice->setCell(xcell, ycell);
+    sites->clear();
+    transitions->clear();
+
+    // every image resolves to its parent's index plus a lattice vector, so
+    // the engine works on canonical sites only
+    foreach (QGraphicsItem *item, items()) {
+        if (item->type() == Site::Type) {
+            Site *site = qgraphicsitem_cast<Site *>(item);
+            if(site->img() == 0) {
+                double nnmod[7];
+                for(int nn = 0; nn < 7; nn++) {
+                    nnmod[nn] = site->nnMod(nn);
+                }
+                site->setIndex(lattice->addSite(site->x(), site->y(), site->stat(), site->en(), nnmod));
+                sites->append(site);
+            }
+        }
+    }
+
+    foreach (QGraphicsItem *item, items()) {
+        if (item->type() == Transition::Type) {
+            Transition *transition = qgraphicsitem_cast<Transition *>(item);
+            Site *startItem = transition->startItem();
+            Site *endItem = transition->endItem();
+            int ssx, ssy, esx, esy;
+            startItem->cellShift(&ssx, &ssy);
+            endItem->cellShift(&esx, &esy);
+            int t = lattice->addTransition(startItem->index(), endItem->index(),
+                                           transition->en(), transition->startPrefac(), transition->endPrefac(),
+                                           esx - ssx, esy - ssy, transition->id());
+            if(t == transitions->size()) transitions->append(transition);
+        }
+    }
+
+    lattice->finalise();
+}
+
+//create the scene items for a lattice model: the item index is built once
+//at the end rather than updated for every insertion
+bool ConfigScene::checkLattice(const Lattice &lattice, QString *error)
+{
+    for(int t = 0; t < lattice.transCount(); t++) {
+        if(qAbs(lattice.transShiftX(t)) > 1 || qAbs(lattice.transShiftY(t)) > 1) {
+            if(error) *error = "Error. The model has a transition beyond the neighbouring cells";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ConfigScene::loadLattice(const Lattice &lattice, QVector<Site *> *sites, QVector<Transition *> *transitions,
+                              QString *error)
+{
+    if(!checkLattice(lattice, error)) return false;
+
+    ItemIndexMethod method = itemIndexMethod();
+    setItemIndexMethod(NoIndex);
+
+    QVector<Site *> items(lattice.siteCount());
+    for(int i = 0; i < lattice.siteCount(); i++) {
+        items[i] = addSite(lattice.occ(i), lattice.en(i), lattice.x(i), lattice.y(i), 0, 0, 0,
+                           lattice.nnMod(i, 1), lattice.nnMod(i, 2), lattice.nnMod(i, 3),
+                           lattice.nnMod(i, 4), lattice.nnMod(i, 5), lattice.nnMod(i, 6));
+        items[i]->setIndex(i);
+    }
+    if(transitions) transitions->fill(0, lattice.transCount());
+
+    //boundary transitions are drawn as the pathway to the end site image
+    //and its mirror from the start site image
+    for(int t = 0; t < lattice.transCount(); t++) {
+        Site *startItem = items[lattice.transStart(t)];
+        Site *endItem = items[lattice.transEnd(t)];
+        int sx = lattice.transShiftX(t);
+        int sy = lattice.transShiftY(t);
+        Transition *transition;
+        if(sx == 0 && sy == 0) {
+            transition = addTrans(startItem, endItem, lattice.transEn(t), 0,
+                                  lattice.startPrefac(t), lattice.endPrefac(t));
+        } else {
+            Site *endImage = siteImage(endItem, sx, sy);
+            Site *startImage = siteImage(startItem, -sx, -sy);
+            transition = addTrans(startItem, endImage, lattice.transEn(t), indx,
+                                  lattice.startPrefac(t), lattice.endPrefac(t));
+            addTrans(startImage, endItem, lattice.transEn(t), indx,
+                     lattice.startPrefac(t), lattice.endPrefac(t));
+            indx++;
+        }
+        if(transitions) (*transitions)[t] = transition;
+    }
+    if(sites) *sites = items;
+
+    setItemIndexMethod(method);
+    emit modelChanged();
+    return true;
+}
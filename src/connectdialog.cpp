@@ -0,0 +1,74 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include <QtWidgets>
+
+#include "connectdialog.h"
+
+ConnectDialog::ConnectDialog(void)
+{
+    cncl = 1;
+
+    QLabel *cutoffLabel = new QLabel(tr("Cutoff distance:"));
+    cutoffEdit = new QLineEdit;
+    cutoffEdit->setText(QString::number(45));
+    cutoffEdit->setValidator(new QDoubleValidator(0.0,100000.0,2, cutoffEdit));
+
+    QLabel *barrierLabel = new QLabel(tr("Barrier (eV):"));
+    barrierEdit = new QLineEdit;
+    barrierEdit->setText(QString::number(1.0));
+    barrierEdit->setValidator(new QDoubleValidator(barrierEdit));
+
+    QLabel *startPFLabel = new QLabel(tr("Start prefactor (THz):"));
+    startPFEdit = new QLineEdit;
+    startPFEdit->setText(QString::number(10.0));
+    startPFEdit->setValidator(new QDoubleValidator(0.0,1.0e6,4, startPFEdit));
+
+    QLabel *endPFLabel = new QLabel(tr("End prefactor (THz):"));
+    endPFEdit = new QLineEdit;
+    endPFEdit->setText(QString::number(10.0));
+    endPFEdit->setValidator(new QDoubleValidator(0.0,1.0e6,4, endPFEdit));
+
+    okButton = new QPushButton(tr("OK"));
+    cancelButton = new QPushButton(tr("Cancel"));
+
+    QGridLayout *connectLayout = new QGridLayout;
+    connectLayout->addWidget(cutoffLabel, 0, 0);
+    connectLayout->addWidget(cutoffEdit, 0, 1);
+    connectLayout->addWidget(barrierLabel, 1, 0);
+    connectLayout->addWidget(barrierEdit, 1, 1);
+    connectLayout->addWidget(startPFLabel, 2, 0);
+    connectLayout->addWidget(startPFEdit, 2, 1);
+    connectLayout->addWidget(endPFLabel, 3, 0);
+    connectLayout->addWidget(endPFEdit, 3, 1);
+    connectLayout->addWidget(okButton, 4, 0);
+    connectLayout->addWidget(cancelButton, 4, 1);
+    setLayout(connectLayout);
+
+    connect(okButton, SIGNAL(clicked()), this, SLOT(okButtonPress()));
+    connect(cancelButton, SIGNAL(clicked()), this, SLOT(cancelButtonPress()));
+
+    setWindowTitle(tr("Auto-connect sites"));
+}
+
+void ConnectDialog::okButtonPress()
+{
+    m_cutoff = cutoffEdit->text().toDouble();
+    m_barrier = barrierEdit->text().toDouble();
+    m_startPF = startPFEdit->text().toDouble();
+    m_endPF = endPFEdit->text().toDouble();
+    cncl = 0;
+    close();
+}
+
+void ConnectDialog::cancelButtonPress()
+{
+    cncl = 1;
+    close();
+}
@@ -0,0 +1,19 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "eventselector.h"
+#include "ratetree.h"
+#include "rateclasses.h"
+
+// create a selector of the given type
+EventSelector *EventSelector::create(Type type)
+{
+    if(type == RateClass) return new RateClassSelector;
+    return new RateTree;
+}
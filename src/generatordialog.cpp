@@ -0,0 +1,138 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include <QtWidgets>
+
+#include "generatordialog.h"
+#include "latticegenerator.h"
+
+GeneratorDialog::GeneratorDialog(void)
+{
+    m_fileOnly = false;
+    cncl = 1;
+
+    QLabel *typeLabel = new QLabel(tr("Lattice:"));
+    typeComboBox = new QComboBox;
+    typeComboBox->addItem("Square");
+    typeComboBox->addItem("Hexagonal");
+    typeComboBox->addItem("Honeycomb");
+
+    QLabel *xLabel = new QLabel(tr("Unit cells x:"));
+    xEdit = new QLineEdit;
+    xEdit->setText(QString::number(10));
+    xEdit->setValidator(new QIntValidator(2,100000, xEdit));
+
+    QLabel *yLabel = new QLabel(tr("Unit cells y:"));
+    yEdit = new QLineEdit;
+    yEdit->setText(QString::number(10));
+    yEdit->setValidator(new QIntValidator(2,100000, yEdit));
+
+    QLabel *spacingLabel = new QLabel(tr("Site spacing:"));
+    spacingEdit = new QLineEdit;
+    spacingEdit->setText(QString::number(40));
+    spacingEdit->setValidator(new QDoubleValidator(1.0,1000.0,2, spacingEdit));
+
+    QLabel *siteEnLabel = new QLabel(tr("Site energy (eV):"));
+    siteEnEdit = new QLineEdit;
+    siteEnEdit->setText(QString::number(0.0));
+    siteEnEdit->setValidator(new QDoubleValidator(siteEnEdit));
+
+    QLabel *nnModLabel = new QLabel(tr("Modifiers 1-6 (eV):"));
+    QHBoxLayout *nnModLayout = new QHBoxLayout;
+    for(int nn = 0; nn < 6; nn++) {
+        nnModEdit[nn] = new QLineEdit;
+        nnModEdit[nn]->setText(QString::number(0.0));
+        nnModEdit[nn]->setValidator(new QDoubleValidator(nnModEdit[nn]));
+        nnModEdit[nn]->setMaximumWidth(50);
+        nnModLayout->addWidget(nnModEdit[nn]);
+    }
+
+    QLabel *barrierLabel = new QLabel(tr("Barrier (eV):"));
+    barrierEdit = new QLineEdit;
+    barrierEdit->setText(QString::number(1.0));
+    barrierEdit->setValidator(new QDoubleValidator(barrierEdit));
+
+    QLabel *startPFLabel = new QLabel(tr("Start prefactor (THz):"));
+    startPFEdit = new QLineEdit;
+    startPFEdit->setText(QString::number(10.0));
+    startPFEdit->setValidator(new QDoubleValidator(0.0,1.0e6,4, startPFEdit));
+
+    QLabel *endPFLabel = new QLabel(tr("End prefactor (THz):"));
+    endPFEdit = new QLineEdit;
+    endPFEdit->setText(QString::number(10.0));
+    endPFEdit->setValidator(new QDoubleValidator(0.0,1.0e6,4, endPFEdit));
+
+    QLabel *coverageLabel = new QLabel(tr("Coverage:"));
+    coverageEdit = new QLineEdit;
+    coverageEdit->setText(QString::number(0.0));
+    coverageEdit->setValidator(new QDoubleValidator(0.0,1.0,4, coverageEdit));
+
+    fileOnlyCheckBox = new QCheckBox(tr("Save to a model file only (for very large lattices)"));
+
+    okButton = new QPushButton(tr("OK"));
+    cancelButton = new QPushButton(tr("Cancel"));
+
+    QGridLayout *generatorLayout = new QGridLayout;
+    generatorLayout->addWidget(typeLabel, 0, 0);
+    generatorLayout->addWidget(typeComboBox, 0, 1);
+    generatorLayout->addWidget(xLabel, 1, 0);
+    generatorLayout->addWidget(xEdit, 1, 1);
+    generatorLayout->addWidget(yLabel, 2, 0);
+    generatorLayout->addWidget(yEdit, 2, 1);
+    generatorLayout->addWidget(spacingLabel, 3, 0);
+    generatorLayout->addWidget(spacingEdit, 3, 1);
+    generatorLayout->addWidget(siteEnLabel, 4, 0);
+    generatorLayout->addWidget(siteEnEdit, 4, 1);
+    generatorLayout->addWidget(nnModLabel, 5, 0);
+    generatorLayout->addLayout(nnModLayout, 5, 1);
+    generatorLayout->addWidget(barrierLabel, 6, 0);
+    generatorLayout->addWidget(barrierEdit, 6, 1);
+    generatorLayout->addWidget(startPFLabel, 7, 0);
+    generatorLayout->addWidget(startPFEdit, 7, 1);
+    generatorLayout->addWidget(endPFLabel, 8, 0);
+    generatorLayout->addWidget(endPFEdit, 8, 1);
+    generatorLayout->addWidget(coverageLabel, 9, 0);
+    generatorLayout->addWidget(coverageEdit, 9, 1);
+    generatorLayout->addWidget(fileOnlyCheckBox, 10, 0, 1, 2);
+    generatorLayout->addWidget(okButton, 11, 0);
+    generatorLayout->addWidget(cancelButton, 11, 1);
+    setLayout(generatorLayout);
+
+    connect(okButton, SIGNAL(clicked()), this, SLOT(okButtonPress()));
+    connect(cancelButton, SIGNAL(clicked()), this, SLOT(cancelButtonPress()));
+
+    setWindowTitle(tr("Generate lattice"));
+}
+
+void GeneratorDialog::configure(LatticeGenerator *generator) const
+{
+    generator->setType(LatticeGenerator::Type(typeComboBox->currentIndex()));
+    generator->setSize(xEdit->text().toInt(), yEdit->text().toInt());
+    generator->setSpacing(spacingEdit->text().toDouble());
+    generator->setSiteEnergy(siteEnEdit->text().toDouble());
+    for(int nn = 0; nn < 6; nn++) {
+        generator->setNNMod(nn + 1, nnModEdit[nn]->text().toDouble());
+    }
+    generator->setBarrier(barrierEdit->text().toDouble());
+    generator->setPrefactors(startPFEdit->text().toDouble(), endPFEdit->text().toDouble());
+    generator->setCoverage(coverageEdit->text().toDouble(), 123);
+}
+
+void GeneratorDialog::okButtonPress()
+{
+    m_fileOnly = fileOnlyCheckBox->isChecked();
+    cncl = 0;
+    close();
+}
+
+void GeneratorDialog::cancelButtonPress()
+{
+    cncl = 1;
+    close();
+}
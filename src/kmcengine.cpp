@@ -0,0 +1,284 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "kmcengine.h"
+#include "lattice.h"
+
+#include <QtMath>
+
+const double KmcEngine::lengthScale = 0.1;
+
+KmcEngine::KmcEngine(Lattice *lattice)
+{
+    m_lattice = lattice;
+    m_rates = EventSelector::create(EventSelector::Tree);
+    m_rng = RandomGenerator::create(RandomGenerator::Xoshiro256);
+    seedRandom(123);
+    m_escapeRate = 0.0;
+    m_energy = 0.0;
+    m_ratesValid = false;
+    m_sinceRebuild = 0;
+    m_stamp = 0;
+    setTemperature(300);
+    reset();
+}
+
+KmcEngine::~KmcEngine()
+{
+    delete m_rates;
+    delete m_rng;
+}
+
+void KmcEngine::setLattice(Lattice *lattice)
+{
+    m_lattice = lattice;
+    m_rates->resize(0);
+    m_mod.clear();
+    m_escapeRate = 0.0;
+    m_energy = 0.0;
+    m_ratesValid = false;
+    m_dirty.clear();
+    m_dirtyMark.clear();
+}
+
+//set the temperature
+void KmcEngine::setTemperature(double temp)
+{
+    m_temp = temp;
+    m_beta = 1.60217662e-19/(m_temp*1.38064852e-23);
+    m_ratesValid = false;
+}
+
+//change the event selection method: the catalog is rebuilt on the next step
+void KmcEngine::setSelector(EventSelector::Type type)
+{
+    if(type == m_rates->type()) return;
+    delete m_rates;
+    m_rates = EventSelector::create(type);
+    m_ratesValid = false;
+}
+
+//change the random number generator, keeping the seed and stream
+void KmcEngine::setGenerator(RandomGenerator::Type type)
+{
+    if(type == m_rng->type()) return;
+    delete m_rng;
+    m_rng = RandomGenerator::create(type);
+    m_rng->seed(m_seed, m_stream);
+}
+
+//restart the random number sequence: replicas use the same seed and a different stream
+void KmcEngine::seedRandom(quint64 seed, quint64 stream)
+{
+    m_seed = seed;
+    m_stream = stream;
+    m_rng->seed(seed, stream);
+}
+
+void KmcEngine::reset()
+{
+    m_time = 0.0;
+    m_nstep = 0;
+    m_xdisp = 0.0;
+    m_ydisp = 0.0;
+}
+
+//coordination modifier to the site energy
+double KmcEngine::siteMod(int i) const
+{
+    int coord = m_lattice->coordination(i);
+    if(coord > 6) coord = 6;
+    if(coord > 0) return m_lattice->nnMod(i, coord);
+    return 0.0;
+}
+
+int KmcEngine::eventFrom(int e) const
+{
+    int t = e/2;
+    return (e & 1) ? m_lattice->transEnd(t) : m_lattice->transStart(t);
+}
+
+int KmcEngine::eventTo(int e) const
+{
+    int t = e/2;
+    return (e & 1) ? m_lattice->transStart(t) : m_lattice->transEnd(t);
+}
+
+double KmcEngine::barrier(int e) const
+{
+    int from = eventFrom(e);
+    double barrier = m_lattice->transEn(e/2) - m_lattice->en(from) - m_mod[from];
+    if(barrier < 0.0) barrier = 0.0;
+    return barrier;
+}
+
+double KmcEngine::prefactor(int e) const
+{
+    return (e & 1) ? m_lattice->endPrefac(e/2) : m_lattice->startPrefac(e/2);
+}
+
+//rate of an event: zero unless the start site is occupied and the end site empty
+double KmcEngine::eventRate(int e) const
+{
+    int from = eventFrom(e);
+    if(!m_lattice->occ(from) || m_lattice->occ(eventTo(e))) return 0.0;
+    double barrier = m_lattice->transEn(e/2) - m_lattice->en(from) - m_mod[from];
+    double pathRate = prefactor(e)*1.0e12;
+    if(barrier > 0.0) pathRate *= qExp(-barrier*m_beta);
+    return pathRate;
+}
+
+// create the rate list and the system energy from the current occupation
+void KmcEngine::buildRates()
+{
+    int nsites = m_lattice->siteCount();
+    int ntrans = m_lattice->transCount();
+
+    m_mod.resize(nsites);
+    m_energy = 0.0;
+    for(int i = 0; i < nsites; i++) {
+        m_mod[i] = siteMod(i);
+        if(m_lattice->occ(i)) m_energy += m_lattice->en(i) - m_mod[i];
+    }
+
+    QVector<double> rates(2*ntrans);
+    for(int e = 0; e < 2*ntrans; e++) {
+        rates[e] = eventRate(e);
+    }
+    m_rates->setRates(rates);
+
+    m_siteMark.fill(0, nsites);
+    m_transMark.fill(0, ntrans);
+    m_stamp = 0;
+    m_sinceRebuild = 0;
+    m_ratesValid = true;
+}
+
+// select transition pathway: ran is uniform on (0,1]
+int KmcEngine::selectEvent(double ran) const
+{
+    return m_rates->select(ran);
+}
+
+//add a site to the set touched by the current event
+void KmcEngine::addAffected(int i)
+{
+    if(m_siteMark[i] != m_stamp) {
+        m_siteMark[i] = m_stamp;
+        m_affected.append(i);
+    }
+}
+
+// perform the transition: move the particle and record the displacement
+// only the start and end sites and their neighbours change coordination, so
+// only the transitions attached to those sites need their rates updating
+void KmcEngine::performEvent(int e, KmcEvent *event)
+{
+    int t = e/2;
+    int from = eventFrom(e);
+    int to = eventTo(e);
+    double dx = m_lattice->transDx(t)*lengthScale;
+    double dy = m_lattice->transDy(t)*lengthScale;
+    if(e & 1) {
+        dx = -dx;
+        dy = -dy;
+    }
+
+    m_escapeRate = m_rates->total();
+    m_stamp++;
+    m_affected.clear();
+    addAffected(from);
+    addAffected(to);
+    for(int k = m_lattice->adjBegin(from); k < m_lattice->adjEnd(from); k++) {
+        addAffected(m_lattice->adjSite(k));
+    }
+    for(int k = m_lattice->adjBegin(to); k < m_lattice->adjEnd(to); k++) {
+        addAffected(m_lattice->adjSite(k));
+    }
+
+    foreach(int i, m_affected) {
+        if(m_lattice->occ(i)) m_energy -= m_lattice->en(i) - m_mod[i];
+    }
+    m_lattice->setOcc(from, 0);
+    m_lattice->setOcc(to, 1);
+    markDirty(from);
+    markDirty(to);
+    foreach(int i, m_affected) {
+        m_mod[i] = siteMod(i);
+        if(m_lattice->occ(i)) m_energy += m_lattice->en(i) - m_mod[i];
+    }
+
+    foreach(int i, m_affected) {
+        for(int k = m_lattice->adjBegin(i); k < m_lattice->adjEnd(i); k++) {
+            int nt = m_lattice->adjTrans(k);
+            if(m_transMark[nt] == m_stamp) continue;
+            m_transMark[nt] = m_stamp;
+            m_rates->setRate(2*nt, eventRate(2*nt));
+            m_rates->setRate(2*nt + 1, eventRate(2*nt + 1));
+        }
+    }
+
+    m_xdisp += dx;
+    m_ydisp += dy;
+
+    if(event) {
+        event->trans = t;
+        event->from = from;
+        event->to = to;
+        event->dx = dx;
+        event->dy = dy;
+    }
+
+    //re-sum the accumulated energy to remove round-off drift
+    if(++m_sinceRebuild > m_lattice->siteCount()) {
+        m_energy = 0.0;
+        for(int i = 0; i < m_lattice->siteCount(); i++) {
+            if(m_lattice->occ(i)) m_energy += m_lattice->en(i) - m_mod[i];
+        }
+        m_sinceRebuild = 0;
+    }
+}
+
+void KmcEngine::markDirty(int i)
+{
+    if(m_dirtyMark.size() != m_lattice->siteCount()) {
+        m_dirty.clear();
+        m_dirtyMark.fill(0, m_lattice->siteCount());
+    }
+    if(m_dirtyMark[i]) return;
+    m_dirtyMark[i] = 1;
+    m_dirty.append(i);
+}
+
+void KmcEngine::takeDirty(QVector<int> *sites)
+{
+    foreach(int i, m_dirty) m_dirtyMark[i] = 0;
+    *sites += m_dirty;
+    m_dirty.clear();
+}
+
+// residence time: ran is uniform on (0,1]
+double KmcEngine::advanceTime(double ran)
+{
+    double timeInt = -qLn(ran)/m_escapeRate;
+    m_time += timeInt;
+    m_nstep++;
+    return timeInt;
+}
+
+// a complete KMC step: returns false if no event is possible
+bool KmcEngine::step(double ran1, double ran2, KmcEvent *event)
+{
+    prepareRates();
+    int e = selectEvent(ran1);
+    if(e < 0) return false;
+    performEvent(e, event);
+    advanceTime(ran2);
+    return true;
+}
@@ -0,0 +1,117 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "kmcworker.h"
+#include "kmcengine.h"
+#include "lattice.h"
+#include "trajectorywriter.h"
+
+#include <QElapsedTimer>
+
+KmcWorker::KmcWorker(QObject *parent)
+    : QThread(parent)
+{
+    m_engine = 0;
+    m_trajectory = 0;
+    m_batchSteps = 1000;
+    m_budget = 15;
+    m_chunk = 0;
+}
+
+KmcWorker::~KmcWorker()
+{
+    stopRun();
+    while(SeriesChunk *chunk = takeSeries()) {
+        delete chunk;
+    }
+}
+
+void KmcWorker::startRun(KmcEngine *engine, int batchSteps, int budget)
+{
+    if(isRunning()) return;
+    m_engine = engine;
+    m_batchSteps = qMax(1, batchSteps);
+    m_budget = budget;
+    m_stop.storeRelease(0);
+    start();
+}
+
+void KmcWorker::stopRun()
+{
+    m_stop.storeRelease(1);
+    wait();
+}
+
+// series chunks queued by the worker, then any left over once it has stopped
+SeriesChunk *KmcWorker::takeSeries()
+{
+    SeriesChunk *chunk = m_series.pop();
+    if(!chunk && isFinished()) {
+        chunk = m_chunk;
+        m_chunk = 0;
+    }
+    return chunk;
+}
+
+//add the sites changed by the batch to the chunk: a chunk the view has not
+//taken yet keeps growing, and a site changed again is simply listed again
+void KmcWorker::takeDirty()
+{
+    if(!m_chunk) return;
+    Lattice *lattice = m_engine->lattice();
+    int first = m_chunk->sites.size();
+    m_engine->takeDirty(&m_chunk->sites);
+    m_chunk->occ.resize(m_chunk->sites.size());
+    for(int k = first; k < m_chunk->sites.size(); k++) {
+        m_chunk->occ[k] = lattice->occ(m_chunk->sites[k]);
+    }
+}
+
+//fill the free snapshot slot
+void KmcWorker::publish(bool stalled)
+{
+    KmcSnapshot *snap = m_snapshots.writeBuffer();
+    snap->steps = m_engine->steps();
+    snap->time = m_engine->time();
+    snap->energy = m_engine->energy();
+    snap->stalled = stalled;
+    m_snapshots.publish();
+}
+
+void KmcWorker::run()
+{
+    m_engine->prepareRates();
+    bool stalled = false;
+    while(!stalled && !m_stop.loadAcquire()) {
+        QElapsedTimer clock;
+        clock.start();
+        for(int n = 0; n < m_batchSteps; n++) {
+            if(m_engine->totalRate() <= 0.0) {
+                stalled = true;
+                break;
+            }
+            if(!m_chunk) m_chunk = new SeriesChunk;
+            m_chunk->time.append(m_engine->time());
+            m_chunk->energy.append(m_engine->energy());
+            KmcEvent event;
+            m_engine->step(&event);
+            if(m_trajectory) {
+                m_trajectory->record(m_engine->steps(), m_engine->time(), event.trans, event.from, event.to);
+            }
+            m_chunk->xDisp.append(m_engine->xDisplacement());
+            m_chunk->yDisp.append(m_engine->yDisplacement());
+            if(m_budget > 0 && clock.elapsed() >= m_budget) break;
+            if(m_stop.loadAcquire()) break;
+        }
+        //if the view has not emptied the queue the chunk keeps growing
+        takeDirty();
+        if(m_chunk && m_series.push(m_chunk)) m_chunk = 0;
+        publish(stalled);
+    }
+}
@@ -9,6 +9,7 @@
 
 #include "latsite.h"
 #include "trans.h"
+#include "lattice.h"
 
 #include <QStyleOption>
 #include <QtWidgets>
@@ -26,6 +27,7 @@ Site::Site(int stat, int img, QMenu *contextMenu, QGraphicsItem *parent)
     //initialise the state and occupation
     state = stat;
     m_img = img;
+    m_index = -1;
 
     QColor color(215,215,215,255);
     this->color = color;
@@ -48,6 +50,23 @@ Site::Site(int stat, int img, QMenu *contextMenu, QGraphicsItem *parent)
     }
 }
 
+int Site::stat() const
+{
+    if(m_img > 0 && parentItem()) return static_cast<const Site *>(parentItem())->state;
+    return state;
+}
+
+int Site::index() const
+{
+    if(m_img > 0 && parentItem()) return static_cast<const Site *>(parentItem())->m_index;
+    return m_index;
+}
+
+void Site::cellShift(int *sx, int *sy) const
+{
+    Lattice::imageShift(m_img, sx, sy);
+}
+
 void Site::removeTransition(Transition *transition)
 {
     int index = transitions.indexOf(transition);
@@ -102,16 +121,16 @@ void Site::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
 
     // change shading based on state/occupation
     if(m_img == 0) {
-        if(state == 0) {
+        if(stat() == 0) {
             painter->setBrush(QBrush(Qt::white));
-        } else if(state == 1) {
+        } else if(stat() == 1) {
             painter->setBrush(QBrush(Qt::gray));
         }
     }
     else {
-        if(state == 0) {
+        if(stat() == 0) {
             painter->setBrush(QBrush(QColor(218, 218, 218, 255)));
-        } else if(state == 1) {
+        } else if(stat() == 1) {
             painter->setBrush(QBrush(Qt::gray));
         }
     }
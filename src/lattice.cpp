@@ -0,0 +1,218 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "lattice.h"
+
+// cell translations of the periodic images, numbered as in ConfigScene::addSite
+static const int imageShifts[9][2] = { {0, 0}, {0, 1}, {1, 1}, {1, 0}, {1, -1},
+                                       {0, -1}, {-1, -1}, {-1, 0}, {-1, 1} };
+
+Lattice::Lattice()
+{
+    m_xcell = 400;
+    m_ycell = 400;
+    m_adjOffset.append(0);
+}
+
+void Lattice::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_occ.clear();
+    m_en.clear();
+    m_nnmod.clear();
+    m_transStart.clear();
+    m_transEnd.clear();
+    m_transEn.clear();
+    m_startPF.clear();
+    m_endPF.clear();
+    m_shiftX.clear();
+    m_shiftY.clear();
+    m_adjOffset.clear();
+    m_adjOffset.append(0);
+    m_adjTrans.clear();
+    m_adjSite.clear();
+    m_nocc.clear();
+    m_pairIndex.clear();
+}
+
+// add a site: nnmod points to the 7 coordination modifiers (index 0 unused)
+int Lattice::addSite(double x, double y, int occ, double en, const double *nnmod)
+{
+    m_x.append(x);
+    m_y.append(y);
+    m_occ.append(occ ? 1 : 0);
+    m_en.append(en);
+    for(int nn = 0; nn < 7; nn++) {
+        m_nnmod.append(nnmod ? nnmod[nn] : 0.0);
+    }
+    m_nocc.clear();
+    return m_occ.size() - 1;
+}
+
+// add a transition between two sites
+// periodic boundary transitions are drawn twice in the scene (the pathway and
+// its mirror image) sharing the same pair ID: only the first one is kept
+int Lattice::addTransition(int start, int end, double en, double startPF, double endPF,
+                           int shiftX, int shiftY, int pairId)
+{
+    if(pairId > 0) {
+        foreach(int t, m_pairIndex.values(pairId)) {
+            if((m_transStart[t] == start && m_transEnd[t] == end) ||
+                    (m_transStart[t] == end && m_transEnd[t] == start)) {
+                return t;
+            }
+        }
+    }
+
+    m_transStart.append(start);
+    m_transEnd.append(end);
+    m_transEn.append(en);
+    m_startPF.append(startPF);
+    m_endPF.append(endPF);
+    m_shiftX.append(shiftX);
+    m_shiftY.append(shiftY);
+
+    int t = m_transStart.size() - 1;
+    if(pairId > 0) m_pairIndex.insert(pairId, t);
+    return t;
+}
+
+// build the site to transition CSR adjacency and the neighbour counters
+void Lattice::finalise()
+{
+    int nsites = m_occ.size();
+    int ntrans = m_transStart.size();
+
+    m_adjOffset.fill(0, nsites + 1);
+    for(int t = 0; t < ntrans; t++) {
+        m_adjOffset[m_transStart[t] + 1]++;
+        if(m_transEnd[t] != m_transStart[t]) m_adjOffset[m_transEnd[t] + 1]++;
+    }
+    for(int i = 0; i < nsites; i++) {
+        m_adjOffset[i+1] += m_adjOffset[i];
+    }
+
+    m_adjTrans.resize(m_adjOffset[nsites]);
+    m_adjSite.resize(m_adjOffset[nsites]);
+    QVector<int> fill = m_adjOffset;
+    for(int t = 0; t < ntrans; t++) {
+        int start = m_transStart[t];
+        int end = m_transEnd[t];
+        m_adjSite[fill[start]] = end;
+        m_adjTrans[fill[start]++] = t;
+        if(end != start) {
+            m_adjSite[fill[end]] = start;
+            m_adjTrans[fill[end]++] = t;
+        }
+    }
+
+    countNeighbours();
+    m_pairIndex.clear();
+}
+
+// replicate the sites and transitions of the cell in one pass: the replica
+// of a transition end is found by index arithmetic rather than a search
+bool Lattice::expand(int nx, int ny)
+{
+    int nsites = m_occ.size();
+    int ntrans = m_transStart.size();
+    qint64 nrep = qint64(nx)*ny;
+    if(nx < 1 || ny < 1 || nrep*nsites > 0x7fffffff || nrep*ntrans > 0x7fffffff ||
+            qint64(m_xcell)*nx > 0x7fffffff || qint64(m_ycell)*ny > 0x7fffffff) {
+        return false;
+    }
+    if(nrep == 1) return true;
+
+    int ns = int(nrep*nsites);
+    m_x.resize(ns);
+    m_y.resize(ns);
+    m_occ.resize(ns);
+    m_en.resize(ns);
+    m_nnmod.resize(ns*7);
+    for(int r = 1; r < nrep; r++) {
+        double dx = (r % nx)*double(m_xcell);
+        double dy = (r / nx)*double(m_ycell);
+        int offset = r*nsites;
+        for(int i = 0; i < nsites; i++) {
+            m_x[offset + i] = m_x[i] + dx;
+            m_y[offset + i] = m_y[i] + dy;
+            m_occ[offset + i] = m_occ[i];
+            m_en[offset + i] = m_en[i];
+        }
+        for(int k = 0; k < nsites*7; k++) {
+            m_nnmod[offset*7 + k] = m_nnmod[k];
+        }
+    }
+
+    //the end of a transition lies in replica (rx + sx, ry + sy): wrapped
+    //back into the new cell its shift counts whole new cells
+    int nt = int(nrep*ntrans);
+    m_transStart.resize(nt);
+    m_transEnd.resize(nt);
+    m_transEn.resize(nt);
+    m_startPF.resize(nt);
+    m_endPF.resize(nt);
+    m_shiftX.resize(nt);
+    m_shiftY.resize(nt);
+    for(int r = nrep - 1; r >= 0; r--) {
+        int rx = r % nx;
+        int ry = r / nx;
+        for(int t = 0; t < ntrans; t++) {
+            int ex = rx + m_shiftX[t];
+            int ey = ry + m_shiftY[t];
+            int wx = ex >= 0 ? ex/nx : -((nx - 1 - ex)/nx);
+            int wy = ey >= 0 ? ey/ny : -((ny - 1 - ey)/ny);
+            int n = r*ntrans + t;
+            m_transStart[n] = r*nsites + m_transStart[t];
+            m_transEnd[n] = (ex - wx*nx + nx*(ey - wy*ny))*nsites + m_transEnd[t];
+            m_transEn[n] = m_transEn[t];
+            m_startPF[n] = m_startPF[t];
+            m_endPF[n] = m_endPF[t];
+            m_shiftX[n] = wx;
+            m_shiftY[n] = wy;
+        }
+    }
+
+    m_xcell *= nx;
+    m_ycell *= ny;
+    finalise();
+    return true;
+}
+
+// count the occupied neighbours of every site from the adjacency
+void Lattice::countNeighbours()
+{
+    int nsites = m_occ.size();
+    m_nocc.fill(0, nsites);
+    for(int i = 0; i < nsites; i++) {
+        for(int k = m_adjOffset[i]; k < m_adjOffset[i+1]; k++) {
+            if(m_occ[m_adjSite[k]]) m_nocc[i]++;
+        }
+    }
+}
+
+// set the occupation of a site: the counters of its neighbours change with it
+void Lattice::setOcc(int i, int occ)
+{
+    occ = occ ? 1 : 0;
+    if(m_occ[i] == occ) return;
+    m_occ[i] = occ;
+    if(m_nocc.size() != m_occ.size()) return;
+    int delta = occ ? 1 : -1;
+    for(int k = m_adjOffset[i]; k < m_adjOffset[i+1]; k++) {
+        m_nocc[m_adjSite[k]] += delta;
+    }
+}
+
+void Lattice::imageShift(int img, int *sx, int *sy)
+{
+    *sx = imageShifts[img][0];
+    *sy = imageShifts[img][1];
+}
@@ -0,0 +1,220 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "latticegenerator.h"
+#include "lattice.h"
+#include "rng.h"
+
+#include <QtMath>
+
+// unit cell of each lattice type in units of the nearest-neighbour distance,
+// with the basis in fractional coordinates (kept off the cell edges) and the
+// bonds as (from, to, cell step x, cell step y)
+struct UnitCell
+{
+    double width;
+    double height;
+    int nbasis;
+    double basis[4][2];
+    int nbonds;
+    int bonds[6][4];
+};
+
+static const UnitCell unitCells[3] = {
+    // square
+    { 1.0, 1.0, 1, { {0.5, 0.5} },
+      2, { {0, 0, 1, 0}, {0, 0, 0, 1} } },
+    // hexagonal (triangular): rows offset by half a spacing
+    { 1.0, 1.7320508075688772, 2, { {0.25, 0.25}, {0.75, 0.75} },
+      6, { {0, 0, 1, 0}, {0, 1, 0, 0}, {0, 1, -1, 0},
+           {1, 1, 1, 0}, {1, 0, 0, 1}, {1, 0, 1, 1} } },
+    // honeycomb: two A-B bonds along y and four diagonal ones per cell
+    { 1.7320508075688772, 3.0, 4, { {0.25, 1.0/12}, {0.25, 5.0/12}, {0.75, 7.0/12}, {0.75, 11.0/12} },
+      6, { {0, 1, 0, 0}, {1, 2, 0, 0}, {1, 2, -1, 0},
+           {2, 3, 0, 0}, {3, 0, 0, 1}, {3, 0, 1, 1} } }
+};
+
+static bool generatorError(QString *error, const QString &message)
+{
+    if(error) *error = message;
+    return false;
+}
+
+LatticeGenerator::LatticeGenerator()
+{
+    m_type = Square;
+    m_nx = 10;
+    m_ny = 10;
+    m_spacing = 40.0;
+    m_siteEn = 0.0;
+    for(int nn = 0; nn < 7; nn++) m_nnmod[nn] = 0.0;
+    m_barrier = 1.0;
+    m_startPF = 10.0;
+    m_endPF = 10.0;
+    m_coverage = 0.0;
+    m_seed = 123;
+}
+
+bool LatticeGenerator::generate(Lattice *lattice, QString *error) const
+{
+    const UnitCell &unit = unitCells[m_type];
+    qint64 ncells = qint64(m_nx)*m_ny;
+    if(ncells*unit.nbonds > 0x7fffffff) {
+        return generatorError(error, "Error. Invalid lattice size");
+    }
+    //a single cell along a direction would bond sites to their own images
+    if(m_nx < 2 || m_ny < 2) {
+        return generatorError(error, "Error. The lattice needs at least 2 unit cells in x and y");
+    }
+    if(m_spacing <= 0.0) {
+        return generatorError(error, "Error. The site spacing must be positive");
+    }
+
+    //the cell dimensions are whole scene units: the unit cell is stretched
+    //very slightly to tile the rounded cell exactly
+    qint64 xcell = qRound64(m_nx*unit.width*m_spacing);
+    qint64 ycell = qRound64(m_ny*unit.height*m_spacing);
+    if(xcell < 1 || ycell < 1 || xcell > 0x7fffffff || ycell > 0x7fffffff) {
+        return generatorError(error, "Error. Invalid lattice size");
+    }
+    double width = double(xcell)/m_nx;
+    double height = double(ycell)/m_ny;
+
+    lattice->clear();
+    lattice->setCell(int(xcell), int(ycell));
+
+    RandomGenerator *rng = RandomGenerator::create(RandomGenerator::Xoshiro256);
+    rng->seed(m_seed);
+    for(int cy = 0; cy < m_ny; cy++) {
+        for(int cx = 0; cx < m_nx; cx++) {
+            for(int b = 0; b < unit.nbasis; b++) {
+                int occ = m_coverage > 0.0 && rng->uniform() <= m_coverage;
+                lattice->addSite((cx + unit.basis[b][0])*width, (cy + unit.basis[b][1])*height,
+                                 occ, m_siteEn, m_nnmod);
+            }
+        }
+    }
+    delete rng;
+
+    //site index of basis b in cell (cx, cy) is (cy*nx + cx)*nbasis + b
+    for(int cy = 0; cy < m_ny; cy++) {
+        for(int cx = 0; cx < m_nx; cx++) {
+            for(int k = 0; k < unit.nbonds; k++) {
+                const int *bond = unit.bonds[k];
+                int ex = cx + bond[2];
+                int ey = cy + bond[3];
+                int sx = ex < 0 ? -1 : ex/m_nx;
+                int sy = ey < 0 ? -1 : ey/m_ny;
+                ex -= sx*m_nx;
+                ey -= sy*m_ny;
+                lattice->addTransition((cy*m_nx + cx)*unit.nbasis + bond[0],
+                                       (ey*m_nx + ex)*unit.nbasis + bond[1],
+                                       m_barrier, m_startPF, m_endPF, sx, sy);
+            }
+        }
+    }
+
+    lattice->finalise();
+    return true;
+}
+
+//minimum image of a separation along one cell dimension
+static double minimumImage(double d, double length, int *shift)
+{
+    *shift = -qFloor(d/length + 0.5);
+    return d + *shift*length;
+}
+
+bool LatticeGenerator::connect(Lattice *lattice, double cutoff, double barrier, double startPF, double endPF,
+                               int *added, QString *error)
+{
+    int xcell = lattice->xCell();
+    int ycell = lattice->yCell();
+    if(cutoff <= 0.0 || 2.0*cutoff >= qMin(xcell, ycell)) {
+        return generatorError(error, "Error. The cutoff must be positive and less than half the cell size");
+    }
+    lattice->finalise();
+
+    //bins at least a cutoff wide: the partners of a site are in its own bin
+    //or one of the eight around it
+    int nsites = lattice->siteCount();
+    int nbx = qMax(1, int(xcell/cutoff));
+    int nby = qMax(1, int(ycell/cutoff));
+    QVector<int> siteBin(nsites);
+    QVector<int> binOffset(nbx*nby + 1, 0);
+    for(int i = 0; i < nsites; i++) {
+        double fx = lattice->x(i)/xcell;
+        double fy = lattice->y(i)/ycell;
+        int bx = qBound(0, int((fx - qFloor(fx))*nbx), nbx - 1);
+        int by = qBound(0, int((fy - qFloor(fy))*nby), nby - 1);
+        siteBin[i] = by*nbx + bx;
+        binOffset[siteBin[i] + 1]++;
+    }
+    for(int b = 0; b < nbx*nby; b++) {
+        binOffset[b+1] += binOffset[b];
+    }
+    QVector<int> binSites(nsites);
+    QVector<int> fill = binOffset;
+    for(int i = 0; i < nsites; i++) {
+        binSites[fill[siteBin[i]]++] = i;
+    }
+
+    double cutoff2 = cutoff*cutoff;
+    int count = 0;
+    for(int i = 0; i < nsites; i++) {
+        int bx = siteBin[i] % nbx;
+        int by = siteBin[i] / nbx;
+        //with fewer than three bins along a side the wrapped neighbours repeat
+        int bins[9];
+        int nbins = 0;
+        for(int oy = -1; oy <= 1; oy++) {
+            for(int ox = -1; ox <= 1; ox++) {
+                int b = ((by + oy + nby) % nby)*nbx + (bx + ox + nbx) % nbx;
+                bool seen = false;
+                for(int k = 0; k < nbins; k++) seen = seen || bins[k] == b;
+                if(!seen) bins[nbins++] = b;
+            }
+        }
+        for(int k = 0; k < nbins; k++) {
+            for(int m = binOffset[bins[k]]; m < binOffset[bins[k] + 1]; m++) {
+                int j = binSites[m];
+                if(j <= i) continue;
+                int sx, sy;
+                double dx = minimumImage(lattice->x(j) - lattice->x(i), xcell, &sx);
+                double dy = minimumImage(lattice->y(j) - lattice->y(i), ycell, &sy);
+                if(dx*dx + dy*dy >= cutoff2) continue;
+                bool joined = false;
+                for(int a = lattice->adjBegin(i); a < lattice->adjEnd(i) && !joined; a++) {
+                    joined = lattice->adjSite(a) == j;
+                }
+                if(joined) continue;
+                lattice->addTransition(i, j, barrier, startPF, endPF, sx, sy);
+                count++;
+            }
+        }
+    }
+
+    lattice->finalise();
+    if(added) *added = count;
+    return true;
+}
+
+bool LatticeGenerator::typeFromName(const QString &name, Type *type)
+{
+    if(name == "square") {
+        *type = Square;
+    } else if(name == "hexagonal") {
+        *type = Hexagonal;
+    } else if(name == "honeycomb") {
+        *type = Honeycomb;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -13,8 +13,20 @@
 #include "mainwindow.h"
 #include "cellsizedialog.h"
 #include "expanddialog.h"
+#include "generatordialog.h"
+#include "connectdialog.h"
+#include "latticegenerator.h"
 #include "plotwindow.h"
 #include "qcustomplot.h"
+#include "lattice.h"
+#include "kmcengine.h"
+#include "kmcworker.h"
+#include "modelio.h"
+#include "trajectorywriter.h"
+#include "trajectoryreader.h"
+#include "checkpoint.h"
+#include "seriesrecorder.h"
+#include "rasterview.h"
 
 #include <QtWidgets>
 #include <QDebug>
@@ -26,7 +38,6 @@
 #include <QFileDialog>
 #include <QFile>
 #include <QXmlStreamWriter>
-#include <QXmlStreamReader>
 #include <QCloseEvent>
 #include <QSvgGenerator>
 #include <QPainter>
@@ -50,6 +61,7 @@ MainWindow::MainWindow()
                 this, SLOT(itemSelected(QGraphicsItem*)));
     connect(scene, SIGNAL(itemdeSelected(QGraphicsItem*)),
                 this, SLOT(itemdeSelected(QGraphicsItem*)));
+    connect(scene, SIGNAL(modelChanged()), this, SLOT(invalidateLattice()));
 
     //draw the simulation cell white on the gray background
     cell = new QGraphicsRectItem;
@@ -79,7 +91,11 @@ MainWindow::MainWindow()
     layout->addWidget(toolBox);
     view = new QGraphicsView(scene);
     view->setRenderHint(QPainter::Antialiasing);
-    layout->addWidget(view);
+    rasterView = new RasterView;
+    viewStack = new QStackedWidget;
+    viewStack->addWidget(view);
+    viewStack->addWidget(rasterView);
+    layout->addWidget(viewStack);
     layout->addWidget(zoomSlider);
 
     connect(zoomSlider, SIGNAL(valueChanged(int)), this, SLOT(setupMatrix()));
@@ -92,11 +108,26 @@ MainWindow::MainWindow()
     setWindowTitle(tr("KMC2D"));
 
     //initialise simulation
-    qsrand(123);
+    lattice = new Lattice;
+    engine = new KmcEngine(lattice);
+    worker = new KmcWorker(this);
+    trajectory = new TrajectoryWriter(this);
+    replay = new TrajectoryReader;
+    series = new SeriesRecorder;
+    replayEvent = -1;
+    replaySteps = 0;
+    workerActive = false;
+    latticeDirty = true;
+    rasterMode = false;
+    highlightSite = -1;
+    transEvent = -1;
+    engine->seedRandom(123);
     nstep = 0;
     pstep = 1;
     kmcDetail = 1;
+    fastMode = false;
     stepDelay = 1.0;
+    m_time = 0.0;
     setTemp(300);
     m_energy = 0.0;
 }
@@ -104,6 +135,7 @@ MainWindow::MainWindow()
 //delete item
 void MainWindow::deleteItem()
 {
+    stopWorker();
     int irem = 0;
     foreach (QGraphicsItem *item, scene->selectedItems()) {
         if (item->type() == Transition::Type) {
@@ -147,6 +179,7 @@ void MainWindow::deleteItem()
              delete item;
          }
     }
+    latticeDirty = true;
 
     barSpinBox->setValue(0.0);
     min1SpinBox->setValue(0.0);
@@ -171,22 +204,8 @@ void MainWindow::deleteItem()
 //delete all items in the simulation cell (and images)
 void MainWindow::clearCell()
 {
-    foreach (QGraphicsItem *item, scene->items()) {
-        if (item->type() == Transition::Type) {
-            scene->removeItem(item);
-            Transition *transition = qgraphicsitem_cast<Transition *>(item);
-            transition->startItem()->removeTransition(transition);
-            transition->endItem()->removeTransition(transition);
-            delete item;
-        }
-    }
-    foreach (QGraphicsItem *item, scene->items()) {
-        if (item->type() == Site::Type) {
-            qgraphicsitem_cast<Site *>(item)->removeTransitions();
-            scene->removeItem(item);
-            delete item;
-        }
-    }
+    stopWorker();
+    removeItems();
     barSpinBox->setValue(0.0);
     min1SpinBox->setValue(0.0);
     min2SpinBox->setValue(0.0);
@@ -211,6 +230,34 @@ void MainWindow::clearCell()
     m_time = 0.0;
     nstep = 0;
     pstep = 1;
+    engine->reset();
+    latticeDirty = true;
+    if(rasterMode) {
+        //the empty scene gives the empty lattice
+        buildLattice();
+        rasterView->setLattice(*lattice);
+    }
+}
+
+//delete the scene items without touching the simulation
+void MainWindow::removeItems()
+{
+    foreach (QGraphicsItem *item, scene->items()) {
+        if (item->type() == Transition::Type) {
+            scene->removeItem(item);
+            Transition *transition = qgraphicsitem_cast<Transition *>(item);
+            transition->startItem()->removeTransition(transition);
+            transition->endItem()->removeTransition(transition);
+            delete item;
+        }
+    }
+    foreach (QGraphicsItem *item, scene->items()) {
+        if (item->type() == Site::Type) {
+            qgraphicsitem_cast<Site *>(item)->removeTransitions();
+            scene->removeItem(item);
+            delete item;
+        }
+    }
 }
 
 void MainWindow::sceneGroupClicked(int)
@@ -254,21 +301,163 @@ void MainWindow::toggleSnap(bool on)
     }
 }
 
-//toggle record trajectory
+//toggle record trajectory: the XYZ or event (.ktr) file starts from the current configuration
 void MainWindow::toggleRecord(bool on)
 {
-    if(on) {
-        recordTraj = true;
+    stopWorker();
+    if(!on) {
+        QString error;
+        bool written = trajectory->close(&error);
+        worker->setTrajectory(0);
+        if(!written) {
+            QMessageBox msgbox;
+            msgbox.setText(error);
+            msgbox.exec();
+        }
+        return;
+    }
+
+    QString trajfile = QFileDialog::getSaveFileName(this, "Save trajectory",
+                                                    QString(),
+                                                    "XYZ Files (*.xyz);;Event Trajectories (*.ktr)");
+    if(latticeDirty) buildLattice();
+    QString error;
+    if(trajfile.isNull() || !trajectory->open(trajfile, *lattice, strideSpinBox->value(),
+                                              engine->steps(), engine->time(), &error)) {
+        if(!trajfile.isNull()) {
+            QMessageBox msgbox;
+            msgbox.setText(error);
+            msgbox.exec();
+        }
+        recordButton->setChecked(false);
+        return;
+    }
+    worker->setTrajectory(trajectory);
+}
+
+//toggle trajectory replay: the timeline scrubs through a recorded event
+//trajectory of the current model
+void MainWindow::toggleReplay(bool on)
+{
+    replay->close();
+    replayEvent = -1;
+    timelineSlider->setEnabled(false);
+    seekEdit->setEnabled(false);
+    if(!on) return;
+
+    QString trajfile = QFileDialog::getOpenFileName(this, "Open trajectory",
+                                                    QString(),
+                                                    "Event Trajectories (*.ktr)");
+    if(trajfile.isNull()) {
+        replayButton->setChecked(false);
+        return;
+    }
+    stopKMC();
+    if(latticeDirty) buildLattice();
+    QString error;
+    if(replay->open(trajfile, &error) &&
+            (replay->siteCount() != lattice->siteCount() || replay->transCount() != lattice->transCount())) {
+        error = "Error. The trajectory was recorded with a different model";
+        replay->close();
+    }
+    if(!replay->isOpen()) {
+        QMessageBox msgbox;
+        msgbox.setText(error);
+        msgbox.exec();
+        replayButton->setChecked(false);
+        return;
+    }
+
+    //the slider counts events: very long trajectories share positions
+    timelineSlider->blockSignals(true);
+    timelineSlider->setRange(0, int(qMin(replay->eventCount(), qint64(INT_MAX))));
+    timelineSlider->setValue(0);
+    timelineSlider->blockSignals(false);
+    timelineSlider->setEnabled(true);
+    seekEdit->setEnabled(true);
+    showReplayEvent(0);
+}
+
+//the timeline slider has moved
+void MainWindow::timelineChanged(int value)
+{
+    if(!replay->isOpen()) return;
+    qint64 event = value;
+    if(timelineSlider->maximum() < replay->eventCount()) {
+        event = qint64(double(value)/timelineSlider->maximum()*replay->eventCount());
+    }
+    showReplayEvent(event);
+}
+
+//go to the last event at or before the entered step or time
+void MainWindow::seekTrajectory()
+{
+    if(!replay->isOpen()) return;
+    bool ok;
+    qint64 event;
+    if(seekComboBox->currentIndex() == 1) {
+        double time = seekEdit->text().toDouble(&ok);
+        event = replay->findTime(time);
     } else {
-        recordTraj = false;
+        qint64 step = seekEdit->text().toLongLong(&ok);
+        event = replay->findStep(step);
+    }
+    if(!ok) return;
+    showReplayEvent(event);
+}
+
+//show the state after a trajectory event: only the sites that changed since
+//the last event shown are redrawn
+void MainWindow::showReplayEvent(qint64 event)
+{
+    stopKMC();
+    if(latticeDirty) buildLattice();
+    if(lattice->siteCount() != replay->siteCount()) {
+        replayButton->setChecked(false);
+        return;
+    }
+
+    QVector<int> changed;
+    if(replayEvent < 0 || engine->steps() != replaySteps) {
+        //the lattice has moved on from the trajectory: compare every site
+        replay->state(event, &replayOcc);
+        for(int i = 0; i < lattice->siteCount(); i++) {
+            if(lattice->occ(i) != replayOcc[i]) changed.append(i);
+        }
+    } else {
+        replay->move(replayEvent, event, &replayOcc, &changed);
+    }
+    foreach(int i, changed) {
+        lattice->setOcc(i, replayOcc[i]);
+        engine->markDirty(i);
+    }
+    showChanges();
+    engine->invalidateRates();
+    replayEvent = event;
+    replaySteps = engine->steps();
+
+    int value = int(qMin(event, qint64(timelineSlider->maximum())));
+    if(timelineSlider->maximum() < replay->eventCount()) {
+        value = int(double(event)/replay->eventCount()*timelineSlider->maximum());
+    }
+    timelineSlider->blockSignals(true);
+    timelineSlider->setValue(value);
+    timelineSlider->blockSignals(false);
+
+    m_time = replay->time(event);
+    simulationTime->clear();
+    simulationTime->setText(QString::number(m_time));
+    simulationStatus->clear();
+    simulationStatus->append("Trajectory step " + QString::number(replay->step(event)));
+    if(event > 0) {
+        const TrajectoryRecord &record = replay->record(event);
+        simulationStatus->append("Site " + QString::number(record.from) + " -> " + QString::number(record.to));
     }
 }
 
 //change the simulation cell size: launch dialog box
 void MainWindow::changeCellSize()
 {
-    int xcellOld = xcell;
-    int ycellOld = ycell;
     CellSizeDialog cellsizedialog(xcell,ycell);
     cellsizedialog.exec();
     if(cellsizedialog.cancel()) return;
@@ -282,53 +471,51 @@ void MainWindow::changeCellSize()
     cell->setRect(0, 0, xcell, ycell);
     perarea->setRect(-xcell-10, -ycell-10, 3*xcell+20, 3*ycell+20);
     redrawCells();
+    if(rasterMode) {
+        //the lattice is the model: only its cell changes
+        stopWorker();
+        lattice->setCell(xcell, ycell);
+        engine->setLattice(lattice);
+        rasterView->setLattice(*lattice);
+        return;
+    }
+    latticeDirty = true;
+
+    //move the image items into the new cell and show those now near the edges
+    updateImages();
+}
 
-    //move the image items
+//place the periodic images of every site for the current cell and margin
+void MainWindow::updateImages()
+{
     foreach (QGraphicsItem *item, scene->items() ) {
-         if (item->type() == Site::Type)
+         if (item->type() == Site::Type && qgraphicsitem_cast<Site *>(item)->img() == 0)
          {
-             foreach (QGraphicsItem *child, item->childItems() )
-             {
-                 qreal ximg = child->scenePos().x();
-                 qreal yimg = child->scenePos().y();
-                 qreal ximgp = child->x();
-                 qreal yimgp = child->y();
-                 if(ximg > 0 && ximg < xcellOld && yimg < 0) {
-                     child->setY(yimgp - (ycell - ycellOld));
-                 } else if(ximg > xcellOld && yimg < 0) {
-                     child->setY(yimgp - (ycell - ycellOld));
-                     child->setX(ximgp + (xcell - xcellOld));
-                 } else if(ximg > xcellOld && yimg > 0 && yimg < ycellOld) {
-                     child->setX(ximgp + (xcell - xcellOld));
-                 } else if(ximg > xcellOld && yimg > ycellOld) {
-                     child->setY(yimgp + (ycell - ycellOld));
-                     child->setX(ximgp + (xcell - xcellOld));
-                 } else if(ximg > 0 && ximg < xcellOld && yimg > ycellOld) {
-                     child->setY(yimgp + (ycell - ycellOld));
-                 } else if(ximg < 0 && yimg > ycellOld) {
-                     child->setY(yimgp + (ycell - ycellOld));
-                     child->setX(ximgp - (xcell - xcellOld));
-                 } else if(ximg < 0 && yimg > 0 && yimg < ycellOld) {
-                     child->setX(ximgp - (xcell - xcellOld));
-                 } else if(ximg < 0 && yimg < 0) {
-                     child->setY(yimgp - (ycell - ycellOld));
-                     child->setX(ximgp - (xcell - xcellOld));
-                 }
-             }
-             qgraphicsitem_cast<Site *>(item)->updateTrans();
+             Site *site = qgraphicsitem_cast<Site *>(item);
+             scene->updateImages(site);
+             site->updateTrans();
          }
     }
 }
 
+//distance outside the cell in which periodic images are shown: images of
+//the remaining sites are only created for boundary transitions
+void MainWindow::changeImageMargin()
+{
+    bool ok;
+    int margin = QInputDialog::getInt(this, "Periodic images", "Show images within this distance of the cell:",
+                                      int(scene->getImageMargin()), 0, qMax(xcell, ycell), 10, &ok);
+    if(!ok) return;
+    scene->setImageMargin(margin);
+    updateImages();
+}
+
 //function to multiply out the system
-//this performs three main functions:
-// 1. Increase the cell size
-// 2. Replicate the sites within the initial cell in x and y directions
-// 3. Create and replace transitions based on the initial and final periodicity
+//the model is replicated in the lattice core: every site and transition is
+//copied once with its replica found by index, and the scene is rebuilt from
+//the expanded lattice in a single pass
 void MainWindow::expandSystem()
 {
-    int xcellOld = xcell;
-    int ycellOld = ycell;
     ExpandDialog expanddialog;
     expanddialog.exec();
     if(expanddialog.cancel()) return;
@@ -336,340 +523,52 @@ void MainWindow::expandSystem()
     int xexp = expanddialog.getx();
     int yexp = expanddialog.gety();
 
-    xcell = xcell*xexp;
-    ycell = ycell*yexp;
-
-    //re-draw the system
-    scene->changeCell(xcell,ycell);
-    scene->setSceneRect(QRectF(0, 0, xcell, ycell));
-    cell->setRect(0, 0, xcell, ycell);
-    perarea->setRect(-xcell-10, -ycell-10, 3*xcell+20, 3*ycell+20);
-    redrawCells();
-
-    //move the image items
-    foreach (QGraphicsItem *item, scene->items() ) {
-         if (item->type() == Site::Type)
-         {
-             foreach (QGraphicsItem *child, item->childItems() )
-             {
-                 qreal ximg = child->scenePos().x();
-                 qreal yimg = child->scenePos().y();
-                 qreal ximgp = child->x();
-                 qreal yimgp = child->y();
-                 if(ximg > 0 && ximg < xcellOld && yimg < 0) {
-                     child->setY(yimgp - (ycell - ycellOld));
-                 } else if(ximg > xcellOld && yimg < 0) {
-                     child->setY(yimgp - (ycell - ycellOld));
-                     child->setX(ximgp + (xcell - xcellOld));
-                 } else if(ximg > xcellOld && yimg > 0 && yimg < ycellOld) {
-                     child->setX(ximgp + (xcell - xcellOld));
-                 } else if(ximg > xcellOld && yimg > ycellOld) {
-                     child->setY(yimgp + (ycell - ycellOld));
-                     child->setX(ximgp + (xcell - xcellOld));
-                 } else if(ximg > 0 && ximg < xcellOld && yimg > ycellOld) {
-                     child->setY(yimgp + (ycell - ycellOld));
-                 } else if(ximg < 0 && yimg > ycellOld) {
-                     child->setY(yimgp + (ycell - ycellOld));
-                     child->setX(ximgp - (xcell - xcellOld));
-                 } else if(ximg < 0 && yimg > 0 && yimg < ycellOld) {
-                     child->setX(ximgp - (xcell - xcellOld));
-                 } else if(ximg < 0 && yimg < 0) {
-                     child->setY(yimgp - (ycell - ycellOld));
-                     child->setX(ximgp - (xcell - xcellOld));
-                 }
-             }
-             qgraphicsitem_cast<Site *>(item)->updateTrans();
-         }
+    Lattice model;
+    currentModel(&model);
+    if(!model.expand(xexp, yexp)) {
+        QMessageBox msgbox;
+        msgbox.setText("Error. The expanded system is too large");
+        msgbox.exec();
+        return;
     }
 
-    //put transition start and end items into a temporary vector
-    QList<Site*> startSites;
-    QList<Site*> endSites;
-    QList<Transition*> stransition;
-    QList<Transition*> btransition;
-    foreach (QGraphicsItem *item, scene->items()) {
-        if (item->type() == Transition::Type) {
-            Transition *itransition = qgraphicsitem_cast<Transition *>(item);
-            if(itransition->id() == 0)
-            {
-                stransition.append(itransition);
-                startSites.append(itransition->startItem());
-                endSites.append(itransition->endItem());
-            } else {
-                btransition.append(itransition);
-            }
-        }
-    }
+    clearCell();
+    loadModel(model);
+}
 
-    int indx = 0;
-    //replicate the sites
-    foreach (QGraphicsItem *item, scene->items() ) {
-         if (item->type() == Site::Type)
-         {
-             if(item->childItems().size() > 0)
-             {
-                 indx++;
-                 qgraphicsitem_cast<Site *>(item)->setID(indx);
-                 qgraphicsitem_cast<Site *>(item)->setRep(0,0);
-                 foreach(QGraphicsItem *citem, item->childItems())
-                 {
-                     qgraphicsitem_cast<Site *>(citem)->setID(indx);
-                     qgraphicsitem_cast<Site *>(citem)->setRep(0,0);
-                 }
-
-                 for(int i=0; i < xexp; i++)
-                 {
-                     for(int j=0; j < yexp; j++)
-                     {
-                         if((i+j) > 0) {
-                             double xadd = item->x() + i*xcellOld;
-                             double yadd = item->y() + j*ycellOld;
-                             int nsite = qgraphicsitem_cast<Site *>(item)->stat();
-                             double nen = qgraphicsitem_cast<Site *>(item)->en();
-                             double m1 = qgraphicsitem_cast<Site *>(item)->nnMod(1);
-                             double m2 = qgraphicsitem_cast<Site *>(item)->nnMod(2);
-                             double m3 = qgraphicsitem_cast<Site *>(item)->nnMod(3);
-                             double m4 = qgraphicsitem_cast<Site *>(item)->nnMod(4);
-                             double m5 = qgraphicsitem_cast<Site *>(item)->nnMod(5);
-                             double m6 = qgraphicsitem_cast<Site *>(item)->nnMod(6);
-                             scene->addSite(nsite,nen,xadd,yadd,indx,i,j,m1,m2,m3,m4,m5,m6);
-                         }
-                     }
-                 }
-             }
-         }
+//create a procedural lattice: large lattices can be written straight to a
+//model file without building the scene
+void MainWindow::generateLattice()
+{
+    GeneratorDialog generatordialog;
+    generatordialog.exec();
+    if(generatordialog.cancel()) return;
+
+    LatticeGenerator generator;
+    generatordialog.configure(&generator);
+    Lattice model;
+    QString error;
+    if(!generator.generate(&model, &error)) {
+        QMessageBox msgbox;
+        msgbox.setText(error);
+        msgbox.exec();
+        return;
     }
 
-    int istart;
-    int iend;
-    //replicate transitions
-    for(int i=0; i < xexp; i++)
-    {
-        for(int j=0; j < yexp; j++)
-        {
-            if((i+j) > 0) {
-                foreach(Transition *itransition, stransition) {
-                    if(itransition->id() == 0)
-                        {
-                            istart = itransition->startItem()->id();
-                            iend = itransition->endItem()->id();
-                            Site *myStartItem;
-                            Site *myEndItem;
-                            foreach (QGraphicsItem *sitem, scene->items()) {
-                                if (sitem->type() == Site::Type) {
-                                    if(qgraphicsitem_cast<Site *>(sitem)->xr() == i && qgraphicsitem_cast<Site *>(sitem)->yr() == j)
-                                    {
-                                        if(qgraphicsitem_cast<Site *>(sitem)->id() == istart)
-                                        {
-                                            myStartItem = qgraphicsitem_cast<Site *>(sitem);
-                                        }
-                                        if(qgraphicsitem_cast<Site *>(sitem)->id() == iend)
-                                        {
-                                            myEndItem = qgraphicsitem_cast<Site *>(sitem);
-                                        }
-                                    }
-                                }
-                            }
-                            double nbar = itransition->en();
-                            double startPF = itransition->startPrefac();
-                            double endPF = itransition->endPrefac();
-                            scene->addTrans(myStartItem,myEndItem,nbar,0,startPF,endPF);
-                        }
-                    }
-                }
-            }
-        }
-
-//  rearrange boundary transitions
-//  and add inter-replica transitions
-
-    int imgStart;
-    int imgEnd;
-    int sindx = 0;
-    int eindx = 0;
-    foreach(Transition *itransition, btransition) {
-        imgStart = itransition->startItem()->img();
-        imgEnd = itransition->endItem()->img();
-        Site *myStartItem1;
-        Site *myEndItem1;
-        Site *myStartItem2;
-        Site *myEndItem2;
-
-        //do the x-direction replication
-        if(imgEnd == 7) {
-            sindx = itransition->startItem()->id();
-            eindx = itransition->endItem()->id();
-            //loop over y-replicas
-            for(int iy = 0; iy < yexp; iy++) {
-                //add new 0,0 boundary transition
-                foreach (QGraphicsItem *sitem, scene->items()) {
-                    if (sitem->type() == Site::Type) {
-                        if(qgraphicsitem_cast<Site *>(sitem)->xr() == (xexp-1) && qgraphicsitem_cast<Site *>(sitem)->yr() == iy)
-                            {
-                                if(qgraphicsitem_cast<Site *>(sitem)->id() == eindx && qgraphicsitem_cast<Site *>(sitem)->img() == 0)
-                                {
-                                    myStartItem1 = qgraphicsitem_cast<Site *>(sitem);
-                                }
-                            }
-                        if(qgraphicsitem_cast<Site *>(sitem)->xr() == 0 && qgraphicsitem_cast<Site *>(sitem)->yr() == iy)
-                        {
-                            if(qgraphicsitem_cast<Site *>(sitem)->id() == sindx && qgraphicsitem_cast<Site *>(sitem)->img() == 3)
-                            {
-                                myEndItem1 = qgraphicsitem_cast<Site *>(sitem);
-                            }
-                         }
-                    }
-                }
-                //add new xexp,0 boundary transition
-                foreach (QGraphicsItem *sitem, scene->items()) {
-                    if (sitem->type() == Site::Type) {
-                        if(qgraphicsitem_cast<Site *>(sitem)->xr() == 0 && qgraphicsitem_cast<Site *>(sitem)->yr() == iy)
-                        {
-                            if(qgraphicsitem_cast<Site *>(sitem)->id() == sindx && qgraphicsitem_cast<Site *>(sitem)->img() == 0)
-                            {
-                                myStartItem2 = qgraphicsitem_cast<Site *>(sitem);
-                            }
-                        }
-                        if(qgraphicsitem_cast<Site *>(sitem)->xr() == (xexp-1) && qgraphicsitem_cast<Site *>(sitem)->yr() == iy)
-                        {
-                            if(qgraphicsitem_cast<Site *>(sitem)->id() == eindx && qgraphicsitem_cast<Site *>(sitem)->img() == 7)
-                             {
-                                 myEndItem2 = qgraphicsitem_cast<Site *>(sitem);
-                             }
-                        }
-                    }
-                }
-                double nbar = itransition->en();
-                scene->addTransPair(myStartItem1,myEndItem1,myStartItem2,myEndItem2,nbar);
-
-                //add inter-replica transitions
-                for(int ix = 0; ix < (xexp-1); ix++) {
-                    foreach (QGraphicsItem *sitem, scene->items()) {
-                        if (sitem->type() == Site::Type) {
-                            if(qgraphicsitem_cast<Site *>(sitem)->xr() == ix && qgraphicsitem_cast<Site *>(sitem)->yr() == iy)
-                            {
-                                if(qgraphicsitem_cast<Site *>(sitem)->id() == eindx && qgraphicsitem_cast<Site *>(sitem)->img() == 0)
-                                {
-                                    myStartItem1 = qgraphicsitem_cast<Site *>(sitem);
-                                }
-                            }
-                            if(qgraphicsitem_cast<Site *>(sitem)->xr() == (ix+1) && qgraphicsitem_cast<Site *>(sitem)->yr() == iy)
-                            {
-                                if(qgraphicsitem_cast<Site *>(sitem)->id() == sindx && qgraphicsitem_cast<Site *>(sitem)->img() == 0)
-                                {
-                                    myEndItem1 = qgraphicsitem_cast<Site *>(sitem);
-                                }
-                            }
-                        }
-                    }
-                    nbar = itransition->en();
-                    double startPF = itransition->startPrefac();
-                    double endPF = itransition->endPrefac();
-                    scene->addTrans(myStartItem1,myEndItem1,nbar,0,startPF,endPF);
-                }
-            }
-        }
-
-        //do the y-direction replication
-        if(imgEnd == 5) {
-            sindx = itransition->startItem()->id();
-            eindx = itransition->endItem()->id();
-            //loop over y-replicas
-            for(int ix = 0; ix < xexp; ix++) {
-                //add new 0 boundary transition
-                foreach (QGraphicsItem *sitem, scene->items()) {
-                    if (sitem->type() == Site::Type) {
-                        if(qgraphicsitem_cast<Site *>(sitem)->yr() == (yexp-1) && qgraphicsitem_cast<Site *>(sitem)->xr() == ix)
-                            {
-                                if(qgraphicsitem_cast<Site *>(sitem)->id() == eindx && qgraphicsitem_cast<Site *>(sitem)->img() == 5)
-                                {
-                                    myStartItem1 = qgraphicsitem_cast<Site *>(sitem);
-                                }
-                            }
-                        if(qgraphicsitem_cast<Site *>(sitem)->yr() == 0 && qgraphicsitem_cast<Site *>(sitem)->xr() == ix)
-                        {
-                            if(qgraphicsitem_cast<Site *>(sitem)->id() == sindx && qgraphicsitem_cast<Site *>(sitem)->img() == 0)
-                            {
-                                myEndItem1 = qgraphicsitem_cast<Site *>(sitem);
-                            }
-                         }
-                    }
-                }
-                //add new yexp boundary transition
-                foreach (QGraphicsItem *sitem, scene->items()) {
-                    if (sitem->type() == Site::Type) {
-                        if(qgraphicsitem_cast<Site *>(sitem)->yr() == 0 && qgraphicsitem_cast<Site *>(sitem)->xr() == ix)
-                        {
-                            if(qgraphicsitem_cast<Site *>(sitem)->id() == sindx && qgraphicsitem_cast<Site *>(sitem)->img() == 1)
-                            {
-                                myStartItem2 = qgraphicsitem_cast<Site *>(sitem);
-                            }
-                        }
-                        if(qgraphicsitem_cast<Site *>(sitem)->yr() == (yexp-1) && qgraphicsitem_cast<Site *>(sitem)->xr() == ix)
-                        {
-                            if(qgraphicsitem_cast<Site *>(sitem)->id() == eindx && qgraphicsitem_cast<Site *>(sitem)->img() == 0)
-                             {
-                                 myEndItem2 = qgraphicsitem_cast<Site *>(sitem);
-                             }
-                        }
-                    }
-                }
-                double nbar = itransition->en();
-                scene->addTransPair(myStartItem1,myEndItem1,myStartItem2,myEndItem2,nbar);
-
-                //add inter-replica transitions
-                for(int iy = 0; iy < (yexp-1); iy++) {
-                    foreach (QGraphicsItem *sitem, scene->items()) {
-                        if (sitem->type() == Site::Type) {
-                            if(qgraphicsitem_cast<Site *>(sitem)->yr() == iy && qgraphicsitem_cast<Site *>(sitem)->xr() == ix)
-                            {
-                                if(qgraphicsitem_cast<Site *>(sitem)->id() == eindx && qgraphicsitem_cast<Site *>(sitem)->img() == 0)
-                                {
-                                    myStartItem1 = qgraphicsitem_cast<Site *>(sitem);
-                                }
-                            }
-                            if(qgraphicsitem_cast<Site *>(sitem)->yr() == (iy+1) && qgraphicsitem_cast<Site *>(sitem)->xr() == ix)
-                            {
-                                if(qgraphicsitem_cast<Site *>(sitem)->id() == sindx && qgraphicsitem_cast<Site *>(sitem)->img() == 0)
-                                {
-                                    myEndItem1 = qgraphicsitem_cast<Site *>(sitem);
-                                }
-                            }
-                        }
-                    }
-                    nbar = itransition->en();
-                    double startPF = itransition->startPrefac();
-                    double endPF = itransition->endPrefac();
-                    scene->addTrans(myStartItem1,myEndItem1,nbar,0,startPF,endPF);
-                }
-            }
+    if(generatordialog.fileOnly()) {
+        QString savefile = QFileDialog::getSaveFileName(this, "Save generated lattice",
+                                                        QString(),
+                                                        "Binary Files (*.kmcb);;XML Files (*.xml)");
+        if(!savefile.isNull() && !ModelIO::write(savefile, model, &error)) {
+            QMessageBox msgbox;
+            msgbox.setText(error);
+            msgbox.exec();
         }
+        return;
     }
 
-    //delete the old boundary transitions
-    foreach (QGraphicsItem *item, scene->items()) {
-        if (item->type() == Transition::Type) {
-            Transition *itransition = qgraphicsitem_cast<Transition *>(item);
-            imgStart = itransition->startItem()->img();
-            imgEnd = itransition->endItem()->img();
-            int isx = itransition->startItem()->xr();
-            int isy = itransition->startItem()->yr();
-            int iex = itransition->endItem()->xr();
-            int iey = itransition->endItem()->yr();
-            if(isx == 0 && isy == 0 && iex == 0 && iey == 0 && imgStart != 0 && imgEnd == 0) {
-                scene->removeItem(item);
-                itransition->startItem()->removeTransition(itransition);
-                itransition->endItem()->removeTransition(itransition);
-                delete item;
-            } else if(iex == 0 && iey == 0 && isx == 0 && isy == 0 && imgStart == 0 && imgEnd != 0) {
-                scene->removeItem(item);
-                itransition->startItem()->removeTransition(itransition);
-                itransition->endItem()->removeTransition(itransition);
-                delete item;
-            }
-
-        }
-    }
+    clearCell();
+    loadModel(model);
 }
 
 //update spinboxes to selected transition properties
@@ -735,6 +634,7 @@ void MainWindow::min1Changed()
     double energy = min1SpinBox->value();
     curveDisplay->setMin1(energy);
     scene->setTransMin1(energy);
+    latticeDirty = true;
 }
 
 //update the graph view and site properties on spinbox change
@@ -743,6 +643,7 @@ void MainWindow::min2Changed()
     double energy = min2SpinBox->value();
     curveDisplay->setMin2(energy);
     scene->setTransMin2(energy);
+    latticeDirty = true;
 }
 
 //update the graph view and transition property on spinbox change
@@ -751,6 +652,7 @@ void MainWindow::barChanged()
     double energy = barSpinBox->value();
     curveDisplay->setBar(energy);
     scene->setTransBar(energy);
+    latticeDirty = true;
 }
 
 //update the nn site energy modifier (start item)
@@ -759,6 +661,7 @@ void MainWindow::startModChanged()
     double energy = startModSpinBox->value();
     int nn = startModifier->currentIndex() + 1;
     scene->setStartMod(nn, energy);
+    latticeDirty = true;
 }
 
 //update the nn site energy modifier (start item)
@@ -767,6 +670,7 @@ void MainWindow::endModChanged()
     double energy = endModSpinBox->value();
     int nn = endModifier->currentIndex() + 1;
     scene->setEndMod(nn, energy);
+    latticeDirty = true;
 }
 
 //update the start-direction pre-factor
@@ -774,6 +678,7 @@ void MainWindow::startPreFacChanged()
 {
     double pf = startPreFactor->value();
     scene->setStartPreFac(pf);
+    latticeDirty = true;
 }
 
 //update the start-direction pre-factor
@@ -781,6 +686,7 @@ void MainWindow::endPreFacChanged()
 {
     double pf = endPreFactor->value();
     scene->setEndPreFac(pf);
+    latticeDirty = true;
 }
 
 //update spinbox value dependent on combobox
@@ -808,12 +714,18 @@ void MainWindow::endModCBChanged()
 //update output detail
 void MainWindow::simDetailChanged()
 {
-    kmcDetail = detailComboBox->currentIndex() + 1;
+    //fast mode steps without detail output
+    bool running = timer->isActive();
+    if(running) stopKMC();
+    fastMode = detailComboBox->currentIndex() == 3;
+    kmcDetail = fastMode ? 1 : detailComboBox->currentIndex() + 1;
+    if(running) startKMC();
 }
 
 //set site as occupied
 void MainWindow::occupied()
 {
+    stopWorker();
     foreach (QGraphicsItem *item, scene->selectedItems()) {
         if (item->type() == Site::Type) {
             Site *site = qgraphicsitem_cast<Site *>(item);
@@ -824,12 +736,14 @@ void MainWindow::occupied()
             }
         }
     }
+    latticeDirty = true;
     scene->update();
 }
 
 //set site as unoccupied
 void MainWindow::unoccupied()
 {
+    stopWorker();
     foreach (QGraphicsItem *item, scene->selectedItems()) {
         if (item->type() == Site::Type) {
             Site *site = qgraphicsitem_cast<Site *>(item);
@@ -840,6 +754,7 @@ void MainWindow::unoccupied()
             }
         }
     }
+    latticeDirty = true;
     scene->update();
 }
 
@@ -1121,14 +1036,22 @@ void MainWindow::createToolBox()
     diceicon->setPixmap(QPixmap(":/icons/dice.png"));
     diceicon->setToolTip("Random number generator seed");
 
+    generatorComboBox = new QComboBox;
+    generatorComboBox->addItem("xoshiro");
+    generatorComboBox->addItem("PCG64");
+    generatorComboBox->addItem("Philox");
+    generatorComboBox->setToolTip("Random number generator");
+
     connect(temperature, SIGNAL(valueChanged(int)),this,SLOT(setTemp(int)));
     connect(seed, SIGNAL(valueChanged(int)),this,SLOT(setSeed(int)));
+    connect(generatorComboBox, SIGNAL(currentIndexChanged(int)),this,SLOT(generatorChanged(int)));
 
     topControls->addWidget(tempicon);
     topControls->addWidget(temperature);
     topControls->addStretch(0);
     topControls->addWidget(diceicon);
     topControls->addWidget(seed);
+    topControls->addWidget(generatorComboBox);
 
     QHBoxLayout *simulationControls = new QHBoxLayout;
 
@@ -1160,6 +1083,11 @@ void MainWindow::createToolBox()
     recordButton->setChecked(false);
     recordButton->setToolTip("Save trajectory");
 
+    strideSpinBox = new QSpinBox;
+    strideSpinBox->setRange(1,1000000);
+    strideSpinBox->setValue(1);
+    strideSpinBox->setToolTip("Trajectory frame stride (steps)");
+
     connect(forwardButton, SIGNAL(clicked()),this,SLOT(stepForward()));
     connect(rewindButton, SIGNAL(clicked()),this,SLOT(rewindSimulation()));
     connect(resetButton, SIGNAL(clicked()),this,SLOT(resetSimulation()));
@@ -1174,6 +1102,44 @@ void MainWindow::createToolBox()
     simulationControls->addWidget(forwardButton);
     simulationControls->addStretch(0);
     simulationControls->addWidget(recordButton);
+    simulationControls->addWidget(strideSpinBox);
+
+    //timeline of a recorded event trajectory
+    QHBoxLayout *replayLayout = new QHBoxLayout;
+
+    replayButton = new QToolButton;
+    replayButton->setIcon(QIcon(QPixmap(":/icons/back.png")));
+    replayButton->setIconSize(QSize(24,24));
+    replayButton->setCheckable(true);
+    replayButton->setChecked(false);
+    replayButton->setToolTip("Replay trajectory");
+
+    timelineSlider = new QSlider(Qt::Horizontal);
+    timelineSlider->setRange(0,0);
+    timelineSlider->setEnabled(false);
+    timelineSlider->setToolTip("Trajectory timeline");
+
+    connect(replayButton, SIGNAL(toggled(bool)),this,SLOT(toggleReplay(bool)));
+    connect(timelineSlider, SIGNAL(valueChanged(int)),this,SLOT(timelineChanged(int)));
+
+    replayLayout->addWidget(replayButton);
+    replayLayout->addWidget(timelineSlider);
+
+    QHBoxLayout *seekLayout = new QHBoxLayout;
+
+    seekComboBox = new QComboBox;
+    seekComboBox->addItem("Step");
+    seekComboBox->addItem("Time");
+    seekComboBox->setToolTip("Go to a step or a time (s)");
+
+    seekEdit = new QLineEdit;
+    seekEdit->setEnabled(false);
+    seekEdit->setToolTip("Go to a step or a time (s)");
+
+    connect(seekEdit, SIGNAL(returnPressed()),this,SLOT(seekTrajectory()));
+
+    seekLayout->addWidget(seekComboBox);
+    seekLayout->addWidget(seekEdit);
 
     QHBoxLayout *infoLayout = new QHBoxLayout;
     connect(timer, SIGNAL(timeout()), this, SLOT(stepForward()));
@@ -1188,10 +1154,19 @@ void MainWindow::createToolBox()
     detailComboBox->addItem("1");
     detailComboBox->addItem("2");
     detailComboBox->addItem("3");
+    detailComboBox->addItem("Fast");
     detailComboBox->setToolTip("Output detail");
 
     connect(detailComboBox, SIGNAL(currentIndexChanged(int)),
             this, SLOT(simDetailChanged()));
+
+    selectorComboBox = new QComboBox;
+    selectorComboBox->addItem("Tree");
+    selectorComboBox->addItem("Classes");
+    selectorComboBox->setToolTip("Event selection method");
+
+    connect(selectorComboBox, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(selectorChanged(int)));
     connect(delaySpinBox, SIGNAL(valueChanged(double)),this,SLOT(setDelay(double)));
 
     graphButton = new QToolButton;
@@ -1209,9 +1184,27 @@ void MainWindow::createToolBox()
     infoLayout->addStretch(0);
     infoLayout->addWidget(listicon);
     infoLayout->addWidget(detailComboBox);
+    infoLayout->addWidget(selectorComboBox);
     infoLayout->addStretch(0);
     infoLayout->addWidget(graphButton);
 
+    QHBoxLayout *batchLayout = new QHBoxLayout;
+
+    batchSpinBox = new QSpinBox;
+    batchSpinBox->setRange(1,1000000);
+    batchSpinBox->setValue(1000);
+    batchSpinBox->setToolTip("Steps per update (fast mode)");
+
+    budgetSpinBox = new QSpinBox;
+    budgetSpinBox->setRange(0,1000);
+    budgetSpinBox->setValue(15);
+    budgetSpinBox->setSuffix(" ms");
+    budgetSpinBox->setToolTip("Time per update, 0 for no limit (fast mode)");
+
+    batchLayout->addWidget(batchSpinBox);
+    batchLayout->addStretch(0);
+    batchLayout->addWidget(budgetSpinBox);
+
     QHBoxLayout *timeLayout = new QHBoxLayout;
 
     QLabel *timeicon = new QLabel();
@@ -1239,8 +1232,13 @@ void MainWindow::createToolBox()
     simulationLayout->addSpacing(15);
     simulationLayout->addLayout(simulationControls);
     simulationLayout->addSpacing(15);
+    simulationLayout->addLayout(replayLayout);
+    simulationLayout->addLayout(seekLayout);
+    simulationLayout->addSpacing(15);
     simulationLayout->addLayout(infoLayout);
     simulationLayout->addSpacing(15);
+    simulationLayout->addLayout(batchLayout);
+    simulationLayout->addSpacing(15);
     simulationLayout->addLayout(timeLayout);
     simulationLayout->addSpacing(15);
     simulationLayout->addWidget(simulationStatus);
@@ -1263,6 +1261,29 @@ void MainWindow::createActions()
     deleteAction->setStatusTip(tr("Delete object from system"));
     connect(deleteAction, SIGNAL(triggered()), this, SLOT(deleteItem()));
 
+    generateAction = new QAction(tr("&Generate Lattice"), this);
+    generateAction->setStatusTip(tr("Create a square, hexagonal or honeycomb supercell"));
+    connect(generateAction, SIGNAL(triggered()), this, SLOT(generateLattice()));
+
+    connectAction = new QAction(tr("Auto-C&onnect"), this);
+    connectAction->setStatusTip(tr("Add transitions between all sites within a cutoff distance"));
+    connect(connectAction, SIGNAL(triggered()), this, SLOT(autoConnect()));
+
+    marginAction = new QAction(tr("Image &Margin"), this);
+    marginAction->setStatusTip(tr("Set how far outside the cell periodic images are shown"));
+    connect(marginAction, SIGNAL(triggered()), this, SLOT(changeImageMargin()));
+
+    rasterAction = new QAction(tr("&Raster View"), this);
+    rasterAction->setCheckable(true);
+    rasterAction->setStatusTip(tr("Draw the lattice as an image: for models too large to edit"));
+    connect(rasterAction, SIGNAL(toggled(bool)), this, SLOT(toggleRaster(bool)));
+
+    energyColorAction = new QAction(tr("Colour Sites by &Energy"), this);
+    energyColorAction->setCheckable(true);
+    energyColorAction->setEnabled(false);
+    energyColorAction->setStatusTip(tr("Shade the raster view by site energy"));
+    connect(energyColorAction, SIGNAL(toggled(bool)), this, SLOT(toggleEnergyColor(bool)));
+
     clearAction = new QAction(("&Clear"), this);
     clearAction->setShortcut(QKeySequence::Cut);
     clearAction->setStatusTip(tr("Clear simulation cell"));
@@ -1278,11 +1299,28 @@ void MainWindow::createActions()
     openAction->setStatusTip("Open configuration file");
     connect(openAction, SIGNAL(triggered()), this, SLOT(openfile()));
 
+    importAction = new QAction(tr("&Import Sites"), this);
+    importAction->setStatusTip("Read site coordinates from a CSV or XYZ file");
+    connect(importAction, SIGNAL(triggered()), this, SLOT(importSites()));
+
     saveAction = new QAction(tr("&Save"), this);
     saveAction->setShortcut(QKeySequence::Save);
     saveAction->setStatusTip("Save configuration file");
     connect(saveAction, SIGNAL(triggered()), this, SLOT(savefile()));
 
+    checkpointAction = new QAction(tr("Save &Checkpoint"), this);
+    checkpointAction->setStatusTip("Save the running simulation");
+    connect(checkpointAction, SIGNAL(triggered()), this, SLOT(saveCheckpoint()));
+
+    restoreAction = new QAction(tr("&Restore Checkpoint"), this);
+    restoreAction->setStatusTip("Continue a saved simulation of the current model");
+    connect(restoreAction, SIGNAL(triggered()), this, SLOT(restoreCheckpoint()));
+
+    spillAction = new QAction(tr("Stream &Series"), this);
+    spillAction->setCheckable(true);
+    spillAction->setStatusTip("Write the full resolution time series to a file");
+    connect(spillAction, SIGNAL(toggled(bool)), this, SLOT(toggleSpill(bool)));
+
     exportAction = new QAction(tr("&Export"), this);
     exportAction->setShortcut(Qt::CTRL + Qt::Key_E);
     exportAction->setStatusTip("Export system as SVG");
@@ -1323,7 +1361,11 @@ void MainWindow::createMenus()
 {
     fileMenu = menuBar()->addMenu(tr("&File"));
     fileMenu->addAction(openAction);
+    fileMenu->addAction(importAction);
     fileMenu->addAction(saveAction);
+    fileMenu->addAction(checkpointAction);
+    fileMenu->addAction(restoreAction);
+    fileMenu->addAction(spillAction);
     fileMenu->addAction(exportAction);
     fileMenu->addAction(printAction);
     fileMenu->addAction(exitAction);
@@ -1331,6 +1373,13 @@ void MainWindow::createMenus()
     itemMenu = menuBar()->addMenu(tr("&System"));
     itemMenu->addAction(deleteAction);
     itemMenu->addAction(clearAction);
+    itemMenu->addAction(generateAction);
+    itemMenu->addAction(connectAction);
+    itemMenu->addAction(marginAction);
+
+    viewMenu = menuBar()->addMenu(tr("&View"));
+    viewMenu->addAction(rasterAction);
+    viewMenu->addAction(energyColorAction);
 
     aboutMenu = menuBar()->addMenu(tr("&Help"));
     aboutMenu->addAction(aboutAction);
@@ -1352,6 +1401,46 @@ void MainWindow::setupMatrix()
     matrix.scale(scale, scale);
 
     view->setMatrix(matrix);
+    rasterView->setZoom(zoomSlider->value(), scale);
+}
+
+//raster view: the scene items are removed and the lattice is drawn as an
+//image, so models of millions of sites can be watched while they run;
+//leaving it builds the scene from the lattice again, in lattice order
+void MainWindow::toggleRaster(bool on)
+{
+    if(on == rasterMode) return;
+    stopWorker();
+    if(on) {
+        //scene edits made part way through a step start the step again
+        if(latticeDirty) {
+            buildLattice();
+            pstep = 1;
+        }
+        int highlight = highlightSite;
+        removeItems();
+        siteItems.clear();
+        transItems.clear();
+        rasterMode = true;
+        rasterView->setLattice(*lattice);
+        rasterView->setHighlight(highlight);
+        viewStack->setCurrentWidget(rasterView);
+    } else {
+        rasterMode = false;
+        //the lattice came through loadModel or the scene, so it can be drawn
+        scene->loadLattice(*lattice, &siteItems, &transItems);
+        latticeDirty = false;
+        if(highlightSite >= 0) siteItems[highlightSite]->highlight();
+        rasterView->setLattice(Lattice());
+        viewStack->setCurrentWidget(view);
+    }
+    energyColorAction->setEnabled(on);
+}
+
+//shade the raster view by site energy rather than occupation
+void MainWindow::toggleEnergyColor(bool on)
+{
+    rasterView->setColorMode(on ? RasterView::SiteEnergy : RasterView::Occupation);
 }
 
 //draw the periodic cells and the mask
@@ -1492,259 +1581,256 @@ void MainWindow::redrawCells()
 }
 
 
-//function to open file dialog and read in the XML configuration file
+//function to open file dialog and read in the XML or binary configuration file
 void MainWindow::openfile()
 {
     QString inputfile = QFileDialog::getOpenFileName(this, "Open XML File",
                                                     QString(),
-                                                    "XML Files (*.xml)");
+                                                    "Model Files (*.xml *.kmcb);;XML Files (*.xml);;Binary Files (*.kmcb)");
 
     if (!inputfile.isNull()) {
 
         clearCell();
 
-        QFile file(inputfile);
-
-        if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        //the model is read into a lattice first: transitions are resolved
+        //against a coordinate index and the scene is then built in one pass
+        Lattice model;
+        model.setCell(xcell, ycell);
+        QString error;
+        if(!ModelIO::read(inputfile, &model, &error)) {
             QMessageBox msgbox;
-            msgbox.setText("Error reading XML file");
+            msgbox.setText(error);
             msgbox.exec();
             return;
         }
 
-        QXmlStreamReader xmlReader(&file);
+        loadModel(model);
+    }
+}
 
+//join every pair of sites within a cutoff by a new transition: the pairs are
+//found in the lattice core and the scene is rebuilt from the result
+void MainWindow::autoConnect()
+{
+    ConnectDialog connectdialog;
+    connectdialog.exec();
+    if(connectdialog.cancel()) return;
+
+    Lattice model;
+    currentModel(&model);
+    QString error;
+    if(!LatticeGenerator::connect(&model, connectdialog.cutoff(), connectdialog.barrier(),
+                                  connectdialog.startPrefac(), connectdialog.endPrefac(), 0, &error)) {
+        QMessageBox msgbox;
+        msgbox.setText(error);
+        msgbox.exec();
+        return;
+    }
 
+    clearCell();
+    loadModel(model);
+}
 
-        xmlReader.readNext();
+//read site coordinates (with optional energy and occupation columns) from a
+//point list: the sites are streamed into a lattice and the scene is built once
+void MainWindow::importSites()
+{
+    QString inputfile = QFileDialog::getOpenFileName(this, "Import sites",
+                                                    QString(),
+                                                    "Coordinate Files (*.csv *.xyz *.txt *.dat);;All Files (*)");
+    if(inputfile.isNull()) return;
+    bool ok;
+    //coordinate files are in Angstrom
+    double scale = QInputDialog::getDouble(this, "Import sites", "Scene units per " + QString(QChar(0x00c5)) + ":",
+                                           1.0/KmcEngine::lengthScale, 1.0e-6, 1.0e6, 4, &ok);
+    if(!ok) return;
+
+    Lattice model;
+    QString error;
+    if(!ModelIO::importPoints(inputfile, &model, scale, &error)) {
+        QMessageBox msgbox;
+        msgbox.setText(error);
+        msgbox.exec();
+        return;
+    }
 
+    clearCell();
+    loadModel(model);
+}
 
-        while(!xmlReader.atEnd()) {
-            xmlReader.readNext();
-            if(xmlReader.isStartElement()) {
-                QString name = xmlReader.name().toString();
-                if(name == "Cell") {
-                    QXmlStreamAttributes attributes = xmlReader.attributes();
-                    foreach(QXmlStreamAttribute attribute, attributes) {
-                        QString aname = attribute.name().toString();
-                        QString avalue = attribute.value().toString();
-                        if(aname == "xDim") {
-                            xcell = avalue.toInt();
-                        }
-                        if(aname == "yDim") {
-                            ycell = avalue.toInt();
-                        }
-                    }
-                    //re-draw the system cell
-                    scene->changeCell(xcell,ycell);
-                    scene->setSceneRect(QRectF(0, 0, xcell, ycell));
-                    cell->setRect(0, 0, xcell, ycell);
-                    perarea->setRect(-xcell-10, -ycell-10, 3*xcell+20, 3*ycell+20);
-                    redrawCells();
-                }
-                if(name == "Site") {
-                    QXmlStreamAttributes attributes = xmlReader.attributes();
-                    int xcrd,ycrd,occt;
-                    double ent,m1,m2,m3,m4,m5,m6 = 0.0;
-                    int sum = 0;
-                    foreach(QXmlStreamAttribute attribute, attributes) {
-                        QString aname = attribute.name().toString();
-                        QString avalue = attribute.value().toString();
-                        if(aname == "xCoord") {
-                            xcrd = avalue.toInt();
-                            sum++;
-                        }
-                        if(aname == "yCoord") {
-                            ycrd = avalue.toInt();
-                            sum++;
-                        }
-                        if(aname == "Occ") {
-                            occt = avalue.toInt();
-                            sum++;
-                        }
-                        if(aname == "En") {
-                            ent = avalue.toDouble();
-                            sum++;
-                        }
-                        if(aname == "Mod1") m1 = avalue.toDouble();
-                        if(aname == "Mod2") m2 = avalue.toDouble();
-                        if(aname == "Mod3") m3 = avalue.toDouble();
-                        if(aname == "Mod4") m4 = avalue.toDouble();
-                        if(aname == "Mod5") m5 = avalue.toDouble();
-                        if(aname == "Mod6") m6 = avalue.toDouble();
-                        }
-                        if(sum != 4) {
-                            QMessageBox msgbox;
-                            msgbox.setText("Error. Malformed system file: Site attributes missing");
-                            msgbox.exec();
-                            return;
-                    }
-                    scene->addSite(occt,ent,xcrd,ycrd,0,0,0,m1,m2,m3,m4,m5,m6);
-                }
-                if(name == "Transition") {
-                    QXmlStreamAttributes attributes = xmlReader.attributes();
-                    int sxcrd,sycrd,excrd,eycrd,idt;
-                    double ent,fpf,bpf;
-                    int sum = 0;
-                    foreach(QXmlStreamAttribute attribute, attributes) {
-                        QString aname = attribute.name().toString();
-                        QString avalue = attribute.value().toString();
-                        if(aname == "xStart") {
-                            sxcrd = avalue.toInt();
-                            sum++;
-                        }
-                        if(aname == "yStart") {
-                            sycrd = avalue.toInt();
-                            sum++;
-                        }
-                        if(aname == "xEnd") {
-                            excrd = avalue.toInt();
-                            sum++;
-                        }
-                        if(aname == "yEnd") {
-                            eycrd = avalue.toInt();
-                            sum++;
-                        }
-                        if(aname == "En") {
-                            ent = avalue.toDouble();
-                            sum++;
-                        }
-                        if(aname == "startPF") {
-                            fpf = avalue.toDouble();
-                            sum++;
-                        }
-                        if(aname == "endPF") {
-                            bpf = avalue.toDouble();
-                            sum++;
-                        }
-                        if(aname == "ID") {
-                            idt = avalue.toInt();
-                            sum++;
-                        }
-                    }
-                    if(sum != 8) {
-                        QMessageBox msgbox;
-                        msgbox.setText("Error. Malformed system file: Trans attributes missing");
-                        msgbox.exec();
-                        return;
-                    }
-                    Site *startItem;
-                    Site *endItem;
-                    bool foundStart = false;
-                    bool foundEnd = false;
-                    foreach(QGraphicsItem *item, scene->items()) {
-                        if(item->type() == Site::Type ) {
-                            Site *sItem = qgraphicsitem_cast<Site *>(item);
-                            int xsp = sItem->scenePos().x();
-                            int ysp = sItem->scenePos().y();
-                            if(xsp == sxcrd && ysp == sycrd) {
-                                startItem = sItem;
-                                foundStart = true;
-                            }
-                            if(xsp == excrd && ysp == eycrd) {
-                                foundEnd = true;
-                                endItem = sItem;
-                            }
-                        }
-                    }
-                    if(!foundStart || !foundEnd) {
-                        QMessageBox msgbox;
-                        msgbox.setText("Error. Malformed system file: hanging transition");
-                        msgbox.exec();
-                        return;
-                    }
-                    scene->addTrans(startItem,endItem,ent,idt,fpf,bpf);
-                }
-            }
-        }
+//re-draw the system cell and create the scene items of a lattice model
+void MainWindow::loadModel(const Lattice &model)
+{
+    QString error;
+    if(!ConfigScene::checkLattice(model, &error)) {
+        QMessageBox msgbox;
+        msgbox.setText(error);
+        msgbox.exec();
+        return;
+    }
 
+    xcell = model.xCell();
+    ycell = model.yCell();
+    scene->changeCell(xcell,ycell);
+    scene->setSceneRect(QRectF(0, 0, xcell, ycell));
+    cell->setRect(0, 0, xcell, ycell);
+    perarea->setRect(-xcell-10, -ycell-10, 3*xcell+20, 3*ycell+20);
+    redrawCells();
+
+    if(rasterMode) {
+        //no scene items: the model goes straight to the simulation lattice
+        *lattice = model;
+        lattice->finalise();
+        engine->setLattice(lattice);
+        siteItems.clear();
+        transItems.clear();
+        highlightSite = -1;
+        latticeDirty = false;
+        rasterView->setLattice(*lattice);
+        return;
     }
+    scene->loadLattice(model);
 }
 
-void MainWindow::savefile() //save scene configuration to an xyz file
+//a copy of the model being edited: the scene, or in the raster view the
+//simulation lattice itself
+void MainWindow::currentModel(Lattice *model)
 {
-    QString savefile = QFileDialog::getSaveFileName(this, "Save coordinates",
-                                                    QString(),
-                                                    "XML Files (*.xml)");
-
-    if (!savefile.isNull()) {
-
-        QFile sfile(savefile);
-        if (sfile.open(QFile::WriteOnly | QFile::Truncate))
-        {
-            QXmlStreamWriter xmlWriter(&sfile);
-            xmlWriter.setAutoFormatting(true);
-            xmlWriter.writeStartDocument();
-            xmlWriter.writeStartElement("KMC2DData");
-            xmlWriter.writeAttribute("version", "v1.0");
-            xmlWriter.writeStartElement("Cell");
-            xmlWriter.writeAttribute("xDim", QString::number(xcell));
-            xmlWriter.writeAttribute("yDim", QString::number(ycell));
-            xmlWriter.writeEndElement();
-            xmlWriter.writeStartElement("ItemList");
-            foreach( QGraphicsItem* item, scene->items())
-            {
-                if(item->type() == Site::Type )
-                {
-                    if(item->childItems().size() > 0) {
-                        Site *mySite = qgraphicsitem_cast<Site *>(item);
-                        xmlWriter.writeStartElement("Site");
-                        xmlWriter.writeAttribute("xCoord", QString::number(mySite->x()));
-                        xmlWriter.writeAttribute("yCoord", QString::number(mySite->y()));
-                        xmlWriter.writeAttribute("Occ", QString::number(mySite->stat()));
-                        xmlWriter.writeAttribute("En", QString::number(mySite->en()));
-                        xmlWriter.writeAttribute("Mod1", QString::number(mySite->nnMod(1)));
-                        xmlWriter.writeAttribute("Mod2", QString::number(mySite->nnMod(2)));
-                        xmlWriter.writeAttribute("Mod3", QString::number(mySite->nnMod(3)));
-                        xmlWriter.writeAttribute("Mod4", QString::number(mySite->nnMod(4)));
-                        xmlWriter.writeAttribute("Mod5", QString::number(mySite->nnMod(5)));
-                        xmlWriter.writeAttribute("Mod6", QString::number(mySite->nnMod(6)));
-                        foreach(QGraphicsItem* child, item->childItems()) {
-                            Site *myChild = qgraphicsitem_cast<Site *>(child);
-                            xmlWriter.writeStartElement("Image");
-                            xmlWriter.writeAttribute("xCoord", QString::number(myChild->scenePos().x()));
-                            xmlWriter.writeAttribute("yCoord", QString::number(myChild->scenePos().y()));
-                            xmlWriter.writeAttribute("ImgNo", QString::number(myChild->img()));
-                            xmlWriter.writeEndElement();
-                        }
-                        xmlWriter.writeEndElement();
-                    }
-                }
-            }
-            foreach( QGraphicsItem* item, scene->items())
-            {
-                if(item->type() == Transition::Type )
-                {
-                    Transition *transition = qgraphicsitem_cast<Transition *>(item);
-                    xmlWriter.writeStartElement("Transition");
-                    xmlWriter.writeAttribute("xStart", QString::number(transition->startItem()->scenePos().x()));
-                    xmlWriter.writeAttribute("yStart", QString::number(transition->startItem()->scenePos().y()));
-                    xmlWriter.writeAttribute("xEnd", QString::number(transition->endItem()->scenePos().x()));
-                    xmlWriter.writeAttribute("yEnd", QString::number(transition->endItem()->scenePos().y()));
-                    xmlWriter.writeAttribute("En", QString::number(transition->en()));
-                    xmlWriter.writeAttribute("startPF", QString::number(transition->startPrefac()));
-                    xmlWriter.writeAttribute("endPF", QString::number(transition->endPrefac()));
-                    xmlWriter.writeAttribute("ID", QString::number(transition->id()));
-                    xmlWriter.writeEndElement();
-                }
-            }
-            xmlWriter.writeEndElement();
-            xmlWriter.writeEndElement();
-            sfile.close();
-        } else
-        {
+    if(rasterMode) {
+        stopWorker();
+        *model = *lattice;
+        return;
+    }
+    QVector<Site *> sites;
+    QVector<Transition *> transitions;
+    scene->buildLattice(model, &sites, &transitions);
+}
+
+//save the simulation state and the recorded series: the model itself is saved separately
+void MainWindow::saveCheckpoint()
+{
+    stopKMC();
+    if(pstep != 1) {
+        QMessageBox msgbox;
+        msgbox.setText("Checkpoints are saved between KMC steps: finish the current step first");
+        msgbox.exec();
+        return;
+    }
+    QString checkfile = QFileDialog::getSaveFileName(this, "Save checkpoint",
+                                                     QString(),
+                                                     "Checkpoint Files (*.kmcc)");
+    if(checkfile.isNull()) return;
+    if(latticeDirty) buildLattice();
+
+    Checkpoint checkpoint;
+    checkpoint.capture(*engine);
+    series->save(&checkpoint);
+    checkpoint.setCounter("nstep", nstep);
+    if(initConf.size() == lattice->siteCount()) {
+        QVector<double> conf;
+        foreach(int occ, initConf) conf.append(occ);
+        checkpoint.setSeries("initconf", conf);
+    }
+    QString error;
+    if(!checkpoint.write(checkfile, &error)) {
+        QMessageBox msgbox;
+        msgbox.setText(error);
+        msgbox.exec();
+    }
+}
+
+//stream every step of the time series to a file: the plots keep a window of
+//recent steps and a decimated history
+void MainWindow::toggleSpill(bool on)
+{
+    stopWorker();
+    takeSeries();
+    if(!on) {
+        QString error;
+        if(!series->closeSpill(&error)) {
             QMessageBox msgbox;
-            msgbox.setText("Error writing XML file");
+            msgbox.setText(error);
             msgbox.exec();
-            return;
         }
-    } else
-    {
+        return;
+    }
+    QString seriesfile = QFileDialog::getSaveFileName(this, "Stream time series",
+                                                      QString(),
+                                                      "Series Files (*.kser)");
+    QString error;
+    if(seriesfile.isNull() || !series->openSpill(seriesfile, &error)) {
+        if(!seriesfile.isNull()) {
+            QMessageBox msgbox;
+            msgbox.setText(error);
+            msgbox.exec();
+        }
+        spillAction->setChecked(false);
+    }
+}
+
+//continue a simulation saved from the current model
+void MainWindow::restoreCheckpoint()
+{
+    QString checkfile = QFileDialog::getOpenFileName(this, "Restore checkpoint",
+                                                     QString(),
+                                                     "Checkpoint Files (*.kmcc)");
+    if(checkfile.isNull()) return;
+    stopKMC();
+    resetSimulation();
+    if(latticeDirty) buildLattice();
+
+    Checkpoint checkpoint;
+    QString error;
+    if(!checkpoint.read(checkfile, &error) || !checkpoint.restore(engine, &error)) {
         QMessageBox msgbox;
-        msgbox.setText("Error writing XML file");
+        msgbox.setText(error);
         msgbox.exec();
         return;
     }
+
+    series->load(checkpoint);
+    initConf.clear();
+    foreach(double occ, checkpoint.series("initconf")) initConf.append(int(occ));
+    nstep = checkpoint.counter("nstep");
+
+    //the controls follow the restored engine
+    temperature->blockSignals(true);
+    temperature->setValue(qRound(engine->temperature()));
+    temperature->blockSignals(false);
+    selectorComboBox->blockSignals(true);
+    selectorComboBox->setCurrentIndex(engine->selector() == EventSelector::RateClass ? 1 : 0);
+    selectorComboBox->blockSignals(false);
+    generatorComboBox->blockSignals(true);
+    generatorComboBox->setCurrentIndex(int(engine->generator()));
+    generatorComboBox->blockSignals(false);
+
+    for(int i = 0; i < lattice->siteCount(); i++) {
+        engine->markDirty(i);
+    }
+    showChanges();
+    m_energy = engine->energy();
+    m_time = engine->time();
+    simulationTime->clear();
+    simulationTime->setText(QString::number(m_time));
+}
+
+void MainWindow::savefile() //save scene configuration to an xyz file
+{
+    QString savefile = QFileDialog::getSaveFileName(this, "Save coordinates",
+                                                    QString(),
+                                                    "XML Files (*.xml);;Binary Files (*.kmcb)");
+    if (savefile.isNull()) return;
+
+    //models are written from a lattice built from the scene: the XML file
+    //lists all eight images of every site, shown in the scene or not
+    Lattice model;
+    currentModel(&model);
+    QString error;
+    if(!ModelIO::write(savefile, model, &error)) {
+        QMessageBox msgbox;
+        msgbox.setText(error);
+        msgbox.exec();
+    }
 }
 
 
@@ -1755,7 +1841,11 @@ void MainWindow::print()
     QPrintDialog dialog(&printer, this);
     if (dialog.exec() == QDialog::Accepted) {
         QPainter painter(&printer);
-        view->render(&painter);
+        if(rasterMode) {
+            rasterView->viewport()->render(&painter);
+        } else {
+            view->render(&painter);
+        }
     }
 #endif
 }
@@ -1802,7 +1892,8 @@ void MainWindow::exportSVG()
 void MainWindow::startKMC()
 {
     startStopButton->setDefaultAction(stopAction);
-    timer->start(stepDelay);
+    //fast mode runs on the worker thread: the timer refreshes the view
+    timer->start(fastMode ? 40 : stepDelay);
 }
 
 //stop the KMC simulation
@@ -1810,100 +1901,254 @@ void MainWindow::stopKMC()
 {
     startStopButton->setDefaultAction(startAction);
     timer->stop();
+    stopWorker();
+}
+
+//hand the engine to the worker thread
+void MainWindow::startWorker()
+{
+    if(latticeDirty) buildLattice();
+
+    if(nstep == 0) {
+        initConf.clear();
+        for(int i = 0; i < lattice->siteCount(); i++) {
+            initConf.append(lattice->occ(i));
+        }
+    }
+
+    setHighlight(-1);
+    showChanges();
+
+    worker->startRun(engine, batchSpinBox->value(), budgetSpinBox->value());
+    workerActive = true;
+}
+
+//take the engine back from the worker thread and bring the view up to date
+//returns false if the worker was not running
+bool MainWindow::stopWorker()
+{
+    if(!workerActive) return false;
+    worker->stopRun();
+    workerActive = false;
+
+    takeSeries();
+    nstep = engine->steps();
+    m_energy = engine->energy();
+    m_time = engine->time();
+    simulationTime->clear();
+    simulationTime->setText(QString::number(m_time));
+    return true;
+}
+
+//append the series recorded by the worker and show the sites it changed
+void MainWindow::takeSeries()
+{
+    while(SeriesChunk *chunk = worker->takeSeries()) {
+        for(int n = 0; n < chunk->time.size(); n++) {
+            series->append(chunk->time[n], chunk->energy[n], chunk->xDisp[n], chunk->yDisp[n]);
+        }
+        for(int k = 0; k < chunk->sites.size(); k++) {
+            showSite(chunk->sites[k], chunk->occ[k]);
+        }
+        delete chunk;
+    }
+    if(rasterMode) rasterView->refresh();
+}
+
+//show the latest snapshot published by the worker
+void MainWindow::showSnapshot()
+{
+    takeSeries();
+    if(!worker->readSnapshot()) return;
+
+    const KmcSnapshot &snap = worker->snapshot();
+    m_time = snap.time;
+    m_energy = snap.energy;
+    simulationTime->clear();
+    simulationTime->setText(QString::number(m_time));
+    if(snap.stalled) stopKMC();
+}
+
+//rebuild the simulation lattice from the scene items
+void MainWindow::buildLattice()
+{
+    //the site numbering changes: end the recorded trajectory
+    if(trajectory->isOpen()) recordButton->setChecked(false);
+    scene->buildLattice(lattice, &siteItems, &transItems);
+    engine->setLattice(lattice);
+    highlightSite = -1;
+    litTrans.clear();
+    latticeDirty = false;
+}
+
+//the scene model has been edited: rebuild the lattice before the next step
+void MainWindow::invalidateLattice()
+{
+    latticeDirty = true;
+}
+
+//update the scene site (and periodic images) to the lattice occupation
+void MainWindow::syncSite(int i)
+{
+    showSite(i, lattice->occ(i));
+}
+
+//redraw a site: only its own region (and those of its images) is invalidated
+void MainWindow::showSite(int i, int occ)
+{
+    if(rasterMode) {
+        rasterView->setSite(i, occ);
+        return;
+    }
+    Site *site = siteItems[i];
+    if(occ) {
+        site->on();
+    } else {
+        site->off();
+    }
+    site->update();
+    //the images draw the parent's occupation
+    foreach (QGraphicsItem *child, site->childItems()) {
+        child->update();
+    }
+}
+
+//redraw the sites in the engine's dirty set: once per frame, however many
+//events the frame covers
+void MainWindow::showChanges()
+{
+    QVector<int> dirty;
+    engine->takeDirty(&dirty);
+    foreach(int i, dirty) {
+        syncSite(i);
+    }
+    if(rasterMode) rasterView->refresh();
+}
+
+//highlight the destination site of the last event, -1 for none: the sites
+//are redrawn with the next frame
+void MainWindow::setHighlight(int i)
+{
+    if(i == highlightSite) return;
+    if(highlightSite >= 0) {
+        if(!rasterMode) siteItems[highlightSite]->stopHighlight();
+        engine->markDirty(highlightSite);
+    }
+    if(i >= 0) {
+        if(!rasterMode) siteItems[i]->highlight();
+        engine->markDirty(i);
+    }
+    if(rasterMode) rasterView->setHighlight(i);
+    highlightSite = i;
+}
+
+//highlight a lattice transition: the raster view does not draw transitions
+void MainWindow::highlightTrans(int t, bool on)
+{
+    if(rasterMode || !transItems[t]) return;
+    if(on) {
+        transItems[t]->highlight();
+        litTrans.append(t);
+    } else {
+        transItems[t]->stopHighlight();
+    }
+    transItems[t]->update();
+}
+
+//fast mode: run a batch of KMC steps limited by a step count and a wall
+//clock budget, then refresh the view once
+void MainWindow::runBatch()
+{
+    if(latticeDirty) buildLattice();
+
+    if(nstep == 0) {
+        initConf.clear();
+        for(int i = 0; i < lattice->siteCount(); i++) {
+            initConf.append(lattice->occ(i));
+        }
+    }
+
+    setHighlight(-1);
+
+    int batchSteps = batchSpinBox->value();
+    int budget = budgetSpinBox->value();
+    QElapsedTimer clock;
+    clock.start();
+    engine->prepareRates();
+    for(int n = 0; n < batchSteps; n++) {
+        if(engine->totalRate() <= 0.0) break;
+        double stepTime = engine->time();
+        double stepEnergy = engine->energy();
+
+        KmcEvent event;
+        engine->step(&event);
+        if(trajectory->isOpen()) {
+            trajectory->record(engine->steps(), engine->time(), event.trans, event.from, event.to);
+        }
+
+        series->append(stepTime, stepEnergy, engine->xDisplacement(), engine->yDisplacement());
+        nstep++;
+
+        if(budget > 0 && clock.elapsed() >= budget) break;
+    }
+
+    showChanges();
+    m_energy = engine->energy();
+    m_time = engine->time();
+    simulationTime->clear();
+    simulationTime->setText(QString::number(m_time));
 }
 
 //move the KMC simulation forward 1 step
 void MainWindow::stepForward()
 {
+    //fast mode takes over between whole steps: while the simulation is
+    //running the engine belongs to the worker thread, a single step forward
+    //runs one batch here
+    if(fastMode && pstep == 1) {
+        if(workerActive && latticeDirty) stopWorker();
+        if(workerActive) {
+            showSnapshot();
+        } else if(timer->isActive()) {
+            startWorker();
+        } else {
+            runBatch();
+        }
+        return;
+    }
+
+    //the model is only re-read from the scene at the start of a step
+    if(pstep == 1 && latticeDirty) {
+        buildLattice();
+    }
+
     //at the initial step - save the configuration
     if(nstep == 0 && pstep == 1) {
         initConf.clear();
-        int count = 0;
-        foreach (QGraphicsItem *item, scene->items()) {
-            if (item->type() == Site::Type) {
-                Site *site = qgraphicsitem_cast<Site *>(item);
-                initConf.append(site->stat());
-                count++;
-            }
+        for(int i = 0; i < lattice->siteCount(); i++) {
+            initConf.append(lattice->occ(i));
         }
     }
 
     // create energy and rate list and save energy
     if(pstep == 1) {
-        m_energy = 0.0;
-        barPFList.clear();
-        rateList.clear();
-        transList.clear();
-        rateTotal = 0.0;
-        bool sceneEmpty = true;
-        foreach (QGraphicsItem *item, scene->items()) {
-            if (item->type() == Site::Type && qgraphicsitem_cast<Site *>(item)->img() == 0) {
-            Site *site = qgraphicsitem_cast<Site *>(item);
-            site->stopHighlight();
-            if(site->stat()) {
-                double site_en = site->en();
-                //apply coordination modifier to minima
-                int coordination = 0;
-                double mod_en = 0.0;
-                foreach(QGraphicsItem *citem, site->transList()) {
-                    if(qgraphicsitem_cast<Transition *>(citem)->startItem()->stat() &&
-                            qgraphicsitem_cast<Transition *>(citem)->endItem()->stat()) {
-                        coordination++;
-                    }
-                }
-                if(coordination > 0) {
-                    mod_en = site->nnMod(coordination);
-                }
-                m_energy += site_en - mod_en;
-                foreach(QGraphicsItem *titem, site->transList()) {
-                    sceneEmpty = false;
-                    Transition *trans = qgraphicsitem_cast<Transition *>(titem);
-                    trans->stopHighlight();
-                    double trans_en = trans->en();
-                    double barrier = trans_en - site_en - mod_en;
-                    double prefac;
-                    if(trans->startItem() == site) {
-                        prefac = trans->startPrefac();
-                    }
-                    else {
-                        prefac = trans->endPrefac();
-                    }
-                    if(barrier < 0.0) barrier = 0;
-                    if(!(trans->startItem()->stat() && trans->endItem()->stat())) {
-                        QPointF barPF(barrier,prefac);
-                        barPFList.append(barPF);
-                        double pathRate = (prefac*1.0e12)*qExp(-barrier*m_beta);
-                        rateList.append(pathRate);
-                        rateTotal += pathRate;
-                        transList.append(titem);
-                    }
-                    trans->stopHighlight();
-                    trans->update();
-                }
-            }
-            }
+        setHighlight(-1);
+        litTrans.clear();
+        engine->prepareRates();
+        if(engine->totalRate() <= 0.0) {
+            showChanges();
+            return;
         }
-        if(sceneEmpty) return;
+        m_energy = engine->energy();
         simulationStatus->clear();
-        energySeries.append(m_energy);
-        timeSeries.append(m_time);
         if(kmcDetail == 2) pstep = 3;
     }
 
     //highlight exit barriers
     if(pstep == 1 && kmcDetail == 3) {
-        foreach (QGraphicsItem *item, scene->items()) {
-            if (item->type() == Site::Type) {
-                Site *site = qgraphicsitem_cast<Site *>(item);
-                if(site->stat()) {
-                    foreach(QGraphicsItem *titem, site->transList()) {
-                        Transition *trans = qgraphicsitem_cast<Transition *>(titem);
-                        if(!(trans->startItem()->stat() && trans->endItem()->stat())) {
-                            trans->highlight();
-                            trans->update();
-                        }
-                    }
-                }
+        for(int e = 0; e < engine->eventCount(); e++) {
+            if(engine->rate(e) > 0.0) {
+                highlightTrans(engine->eventTrans(e), true);
             }
         }
 
@@ -1912,11 +2157,13 @@ void MainWindow::stepForward()
         simulationStatus->append("Bar (eV) \t Pre-fac (THz)");
         simulationStatus->setTextColor(Qt::black);
         simulationStatus->append(" ");
-        foreach(QPointF barPF, barPFList) {
-            QString en_val = QString::number(barPF.x());
-            QString pf_val = QString::number(barPF.y());
-            simulationStatus->setAlignment(Qt::AlignLeft);
-            simulationStatus->append(en_val + "\t" + pf_val);
+        for(int e = 0; e < engine->eventCount(); e++) {
+            if(engine->rate(e) > 0.0) {
+                QString en_val = QString::number(engine->barrier(e));
+                QString pf_val = QString::number(engine->prefactor(e));
+                simulationStatus->setAlignment(Qt::AlignLeft);
+                simulationStatus->append(en_val + "\t" + pf_val);
+            }
         }
     }
 
@@ -1929,23 +2176,12 @@ void MainWindow::stepForward()
             simulationStatus->append("Rates (Hz):");
             simulationStatus->append(" ");
             simulationStatus->setTextColor(Qt::black);
-            foreach(double irate, rateList) {
-                QString prate = QString::number(irate);
-                simulationStatus->setAlignment(Qt::AlignRight);
-                simulationStatus->append(prate);
-            }
-            foreach (QGraphicsItem *item, scene->items()) {
-                if (item->type() == Site::Type) {
-                    Site *site = qgraphicsitem_cast<Site *>(item);
-                    if(site->stat()) {
-                        foreach(QGraphicsItem *titem, site->transList()) {
-                            Transition *trans = qgraphicsitem_cast<Transition *>(titem);
-                            if(!(trans->startItem()->stat() && trans->endItem()->stat())) {
-                                trans->stopHighlight();
-                                trans->update();
-                            }
-                        }
-                    }
+            for(int e = 0; e < engine->eventCount(); e++) {
+                if(engine->rate(e) > 0.0) {
+                    QString prate = QString::number(engine->rate(e));
+                    simulationStatus->setAlignment(Qt::AlignRight);
+                    simulationStatus->append(prate);
+                    highlightTrans(engine->eventTrans(e), false);
                 }
             }
         } else {
@@ -1955,27 +2191,8 @@ void MainWindow::stepForward()
 
     // select transition pathway
     if(pstep == 3) {
-        foreach (QGraphicsItem *item, scene->items()) {
-            if (item->type() == Site::Type) {
-            Site *site = qgraphicsitem_cast<Site *>(item);
-            foreach(QGraphicsItem *titem, site->transList()) {
-                Transition *trans = qgraphicsitem_cast<Transition *>(titem);
-                trans->stopHighlight();
-                trans->update();
-            }
-            }
-        }
-        double transProb = 0.0;
-        int icount = 0;
-        double ran1 = qrand()*1.0/RAND_MAX;
-        foreach(double pathRate, rateList) {
-            if(ran1 > transProb && ran1 <= (transProb + pathRate/rateTotal)) {
-                transPath = transList[icount];
-                break;
-            }
-            transProb += pathRate/rateTotal;
-            icount++;
-        }
+        double ran1 = engine->uniform();
+        transEvent = engine->selectEvent(ran1);
         if(kmcDetail > 1) {
             simulationStatus->clear();
             simulationStatus->setAlignment(Qt::AlignLeft);
@@ -1983,116 +2200,45 @@ void MainWindow::stepForward()
             simulationStatus->append("Rand: "+QString::number(ran1));
             simulationStatus->setTextColor(Qt::black);
             simulationStatus->append(" ");
-            int pcount = 0;
-            foreach(double irate, rateList) {
-                QString prate = QString::number(irate);
-                simulationStatus->setAlignment(Qt::AlignRight);
-                if(icount == pcount) {
-                    simulationStatus->setTextBackgroundColor(Qt::red);
-                } else {
-                    simulationStatus->setTextBackgroundColor(QColor(238,238,238,255));
+            for(int e = 0; e < engine->eventCount(); e++) {
+                if(engine->rate(e) > 0.0) {
+                    QString prate = QString::number(engine->rate(e));
+                    simulationStatus->setAlignment(Qt::AlignRight);
+                    if(e == transEvent) {
+                        simulationStatus->setTextBackgroundColor(Qt::red);
+                    } else {
+                        simulationStatus->setTextBackgroundColor(QColor(238,238,238,255));
+                    }
+                    simulationStatus->append(prate);
                 }
-                simulationStatus->append(prate);
-                pcount++;
             }
             simulationStatus->setTextBackgroundColor(QColor(238,238,238,255));
         } else {
             pstep =4;
         }
 
-        qgraphicsitem_cast<Transition *>(transPath)->highlight();
-        qgraphicsitem_cast<Transition *>(transPath)->update();
+        highlightTrans(engine->eventTrans(transEvent), true);
     }
 
-    QPointF startPos, endPos;
-    //perform the transition - taking into account the periodic boundaries
+    //perform the transition and record the displacement
     if(pstep == 4) {
-        if(qgraphicsitem_cast<Transition *>(transPath)->startItem()->stat()) {
-            qgraphicsitem_cast<Transition *>(transPath)->startItem()->off();
-            qgraphicsitem_cast<Transition *>(transPath)->startItem()->update();
-            startPos = qgraphicsitem_cast<Transition *>(transPath)->startItem()->scenePos();
-            endPos = qgraphicsitem_cast<Transition *>(transPath)->endItem()->scenePos();
-            foreach (QGraphicsItem *child, qgraphicsitem_cast<Transition *>(transPath)->startItem()->childItems()) {
-                qgraphicsitem_cast<Site *>(child)->off();
-                qgraphicsitem_cast<Site *>(child)->update();
-            }
-            if(qgraphicsitem_cast<Transition *>(transPath)->endItem()->childItems().size() > 0) {
-                qgraphicsitem_cast<Transition *>(transPath)->endItem()->on();
-                qgraphicsitem_cast<Transition *>(transPath)->endItem()->highlight();
-                qgraphicsitem_cast<Transition *>(transPath)->endItem()->update();
-                foreach (QGraphicsItem *child, qgraphicsitem_cast<Transition *>(transPath)->endItem()->childItems()) {
-                    qgraphicsitem_cast<Site *>(child)->on();
-                    qgraphicsitem_cast<Site *>(child)->update();
-                }
-            } else {
-                QGraphicsItem *parent = qgraphicsitem_cast<Transition *>(transPath)->endItem()->parentItem();
-                qgraphicsitem_cast<Site *>(parent)->on();
-                qgraphicsitem_cast<Site *>(parent)->highlight();
-                qgraphicsitem_cast<Site *>(parent)->update();
-                foreach (QGraphicsItem *child, parent->childItems()) {
-                    qgraphicsitem_cast<Site *>(child)->on();
-                    qgraphicsitem_cast<Site *>(child)->update();
-                }
-            }
-
-        } else {
-            qgraphicsitem_cast<Transition *>(transPath)->endItem()->off();
-            qgraphicsitem_cast<Transition *>(transPath)->endItem()->update();
-            endPos = qgraphicsitem_cast<Transition *>(transPath)->startItem()->scenePos();
-            startPos = qgraphicsitem_cast<Transition *>(transPath)->endItem()->scenePos();
-            foreach (QGraphicsItem *child, qgraphicsitem_cast<Transition *>(transPath)->endItem()->childItems()) {
-                qgraphicsitem_cast<Site *>(child)->off();
-                qgraphicsitem_cast<Site *>(child)->update();
-            }
-            if(qgraphicsitem_cast<Transition *>(transPath)->startItem()->childItems().size() > 0) {
-                qgraphicsitem_cast<Transition *>(transPath)->startItem()->on();
-                qgraphicsitem_cast<Transition *>(transPath)->startItem()->highlight();
-                qgraphicsitem_cast<Transition *>(transPath)->startItem()->update();
-                foreach (QGraphicsItem *child, qgraphicsitem_cast<Transition *>(transPath)->startItem()->childItems()) {
-                    qgraphicsitem_cast<Site *>(child)->on();
-                    qgraphicsitem_cast<Site *>(child)->update();
-                }
-            } else {
-                QGraphicsItem *parent = qgraphicsitem_cast<Transition *>(transPath)->startItem()->parentItem();
-                qgraphicsitem_cast<Site *>(parent)->on();
-                qgraphicsitem_cast<Site *>(parent)->highlight();
-                qgraphicsitem_cast<Site *>(parent)->update();
-                foreach (QGraphicsItem *child, parent->childItems()) {
-                    qgraphicsitem_cast<Site *>(child)->on();
-                    qgraphicsitem_cast<Site *>(child)->update();
-                }
-            }
-        }
-        if(kmcDetail == 1) {
-            qgraphicsitem_cast<Transition *>(transPath)->startItem()->stopHighlight();
-            qgraphicsitem_cast<Transition *>(transPath)->endItem()->stopHighlight();
-        }
-    }
+        engine->performEvent(transEvent, &stepEvent);
+        if(kmcDetail > 1) setHighlight(stepEvent.to);
 
-    // record displacement
-    float xDisplacement;
-    float yDisplacement;
-    if(nstep == 0) {
-        xDisplacement = (endPos.x() - startPos.x())*0.1;
-        yDisplacement = (endPos.y() - startPos.y())*0.1;
-    } else {
-        xDisplacement = (endPos.x() - startPos.x())*0.1 + displaceXSeries.last();
-        yDisplacement = (endPos.y() - startPos.y())*0.1 + displaceYSeries.last();
+        //the time and energy are still those before the event
+        series->append(m_time, m_energy, engine->xDisplacement(), engine->yDisplacement());
     }
-    float sDisplacement = xDisplacement*xDisplacement + yDisplacement*yDisplacement;
-    displaceXSeries.append(xDisplacement);
-    displaceYSeries.append(yDisplacement);
-    displaceSquared.append(sDisplacement);
 
     //update time
     if(kmcDetail == 1) pstep = 5;
     if(pstep == 5) {
-        qgraphicsitem_cast<Transition *>(transPath)->stopHighlight();
-        qgraphicsitem_cast<Transition *>(transPath)->update();
+        highlightTrans(engine->eventTrans(transEvent), false);
 
-        double timeInt;
-        double ran2 = qrand()*1.0/RAND_MAX;
-        timeInt = -qLn(ran2)/rateTotal;
+        double ran2 = engine->uniform();
+        double timeInt = engine->advanceTime(ran2);
+        if(trajectory->isOpen()) {
+            trajectory->record(engine->steps(), engine->time(), stepEvent.trans, stepEvent.from, stepEvent.to);
+        }
         if(kmcDetail > 1) {
             simulationStatus->clear();
             simulationStatus->setTextBackgroundColor(QColor(238,238,238,255));
@@ -2107,7 +2253,7 @@ void MainWindow::stepForward()
             simulationStatus->append(QString::number(timeInt));
             simulationStatus->setAlignment(Qt::AlignRight);
         }
-        m_time += timeInt;
+        m_time = engine->time();
         simulationTime->clear();
         simulationTime->setText(QString::number(m_time));
     }
@@ -2117,24 +2263,21 @@ void MainWindow::stepForward()
         pstep = 1;
         nstep++;
     }
+    showChanges();
 }
 
 //rewind - set configuration to that recorded in initConfig
 void MainWindow::rewindSimulation()
 {
-    int count = 0;
-    foreach (QGraphicsItem *item, scene->items()) {
-        if (item->type() == Site::Type) {
-            Site *site = qgraphicsitem_cast<Site *>(item);
-            if(initConf[count] == 0) {
-                site->off();
-                site->update();
-            } else {
-                site->on();
-                site->update();
-            }
-            count++;
+    stopWorker();
+    if(!latticeDirty && initConf.size() == lattice->siteCount()) {
+        for(int i = 0; i < lattice->siteCount(); i++) {
+            if(lattice->occ(i) == initConf[i]) continue;
+            lattice->setOcc(i, initConf[i]);
+            engine->markDirty(i);
         }
+        showChanges();
+        engine->invalidateRates();
     }
     resetSimulation();
 }
@@ -2142,49 +2285,80 @@ void MainWindow::rewindSimulation()
 //reset - time to zero, unhighlight everything and clear record arrays
 void MainWindow::resetSimulation()
 {
-    foreach (QGraphicsItem *item, scene->items()) {
-        if (item->type() == Site::Type) {
-        Site *site = qgraphicsitem_cast<Site *>(item);
-        site->stopHighlight();
-        site->update();
-        foreach(QGraphicsItem *titem, site->transList()) {
-            Transition *trans = qgraphicsitem_cast<Transition *>(titem);
-            trans->stopHighlight();
-            trans->update();
+    stopWorker();
+    //a recorded trajectory ends with the run
+    if(trajectory->isOpen()) recordButton->setChecked(false);
+    //only the site and transitions lit by the last step are redrawn: after an
+    //edit the item lists are out of date and the scene is searched instead
+    if(latticeDirty) {
+        foreach (QGraphicsItem *item, scene->items()) {
+            if (item->type() == Site::Type) {
+            Site *site = qgraphicsitem_cast<Site *>(item);
+            site->stopHighlight();
+            site->update();
+            foreach(QGraphicsItem *titem, site->transList()) {
+                Transition *trans = qgraphicsitem_cast<Transition *>(titem);
+                trans->stopHighlight();
+                trans->update();
+            }
+            }
         }
+        highlightSite = -1;
+    } else {
+        foreach(int t, litTrans) {
+            highlightTrans(t, false);
         }
+        setHighlight(-1);
+        showChanges();
     }
+    litTrans.clear();
     m_time = 0.0;
+    replayEvent = -1;
     simulationStatus->clear();
     simulationTime->clear();
     simulationTime->setText(QString::number(m_time));
-    timeSeries.clear();
-    energySeries.clear();
+    series->clear();
     coordSeries1.clear();
     coordSeries2.clear();
     coordSeries3.clear();
     coordSeries4.clear();
     coordSeries5.clear();
     coordSeries6.clear();
-    displaceXSeries.clear();
-    displaceYSeries.clear();
-    displaceSquared.clear();
     m_energy = 0.0;
     nstep = 0;
     pstep = 1;
+    engine->reset();
 }
 
 //set the temperature
 void MainWindow::setTemp(int tmp)
 {
-    m_temp = tmp*1.0;
-    m_beta = 1.60217662e-19/(m_temp*1.38064852e-23);
+    stopWorker();
+    engine->setTemperature(tmp*1.0);
+}
+
+//set the event selection method: a binary rate tree or rate classes
+void MainWindow::selectorChanged(int index)
+{
+    stopWorker();
+    engine->setSelector(index == 1 ? EventSelector::RateClass : EventSelector::Tree);
 }
 
-//set the seed of the Mersenne Twister
+//set the seed of the random number generator
 void MainWindow::setSeed(int isd)
 {
-    qsrand(isd);
+    stopWorker();
+    engine->seedRandom(isd);
+    resetSimulation();
+}
+
+//change the random number generator and restart its sequence
+void MainWindow::generatorChanged(int index)
+{
+    stopWorker();
+    RandomGenerator::Type types[3] = { RandomGenerator::Xoshiro256, RandomGenerator::Pcg64,
+                                       RandomGenerator::Philox };
+    engine->setGenerator(types[index]);
     resetSimulation();
 }
 
@@ -2199,10 +2373,8 @@ void MainWindow::setDelay(double delay)
 //open window to plot simulation vectors
 void MainWindow::openGraphBox()
 {
-    startStopButton->setDefaultAction(startAction);
-    timer->stop();
+    stopKMC();
 
-    PlotWindow *plotwindow = new PlotWindow(&energySeries,&timeSeries,
-                                            &displaceXSeries,&displaceYSeries,&displaceSquared);
+    PlotWindow *plotwindow = new PlotWindow(series);
     plotwindow->show();
 }
@@ -0,0 +1,673 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "modelio.h"
+#include "lattice.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <QtMath>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// transitions refer to sites by the coordinates written for the site or
+// one of its images: looked up exactly, and by the truncated coordinates
+// for legacy files whose transition ends were not written as exactly
+static quint64 coordKey(double x, double y)
+{
+    return (quint64(quint32(int(x))) << 32) | quint64(quint32(int(y)));
+}
+
+class SiteIndex
+{
+public:
+    enum { Missing = -1, Ambiguous = -2 };
+
+    void insert(double x, double y, int site)
+    {
+        add(&m_exact, qMakePair(x + 0.0, y + 0.0), site); // -0.0 and 0.0 are one key
+        add(&m_truncated, coordKey(x, y), site);
+    }
+
+    int find(double x, double y) const
+    {
+        int site = m_exact.value(qMakePair(x + 0.0, y + 0.0), Missing);
+        return site == Missing ? m_truncated.value(coordKey(x, y), Missing) : site;
+    }
+
+private:
+    // a key that names two different sites cannot resolve a transition
+    template<typename Key>
+    static void add(QHash<Key, int> *index, const Key &key, int site)
+    {
+        typename QHash<Key, int>::iterator it = index->find(key);
+        if(it == index->end()) index->insert(key, site);
+        else if(*it != site) *it = Ambiguous;
+    }
+
+    QHash<QPair<double, double>, int> m_exact;
+    QHash<quint64, int> m_truncated;
+};
+
+// transition attributes held until all the sites are read
+struct XmlTransition
+{
+    double xs, ys, xe, ye;
+    double en, spf, epf;
+    int id;
+};
+
+static bool xmlError(QString *error, const QString &message)
+{
+    if(error) *error = message;
+    return false;
+}
+
+bool ModelIO::readXml(const QString &filename, Lattice *lattice, QString *error)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        return xmlError(error, "Error reading XML file");
+    }
+
+    lattice->clear();
+
+    // site (and image) coordinates -> 9*site index + image number
+    SiteIndex siteIndex;
+    QVector<XmlTransition> transitions;
+    int xcell = lattice->xCell();
+    int ycell = lattice->yCell();
+    int lastSite = -1;
+
+    QXmlStreamReader xmlReader(&file);
+    while(!xmlReader.atEnd()) {
+        xmlReader.readNext();
+        if(!xmlReader.isStartElement()) continue;
+
+        QString name = xmlReader.name().toString();
+        QXmlStreamAttributes attributes = xmlReader.attributes();
+        if(name == "Cell") {
+            if(attributes.hasAttribute("xDim")) xcell = attributes.value("xDim").toString().toInt();
+            if(attributes.hasAttribute("yDim")) ycell = attributes.value("yDim").toString().toInt();
+            lattice->setCell(xcell, ycell);
+        } else if(name == "Site") {
+            if(!attributes.hasAttribute("xCoord") || !attributes.hasAttribute("yCoord") ||
+                    !attributes.hasAttribute("Occ") || !attributes.hasAttribute("En")) {
+                return xmlError(error, "Error. Malformed system file: Site attributes missing");
+            }
+            double xcrd = attributes.value("xCoord").toString().toDouble();
+            double ycrd = attributes.value("yCoord").toString().toDouble();
+            int occt = attributes.value("Occ").toString().toInt();
+            double ent = attributes.value("En").toString().toDouble();
+            double nnmod[7];
+            nnmod[0] = 0.0;
+            for(int nn = 1; nn < 7; nn++) {
+                nnmod[nn] = attributes.value("Mod" + QString::number(nn)).toString().toDouble();
+            }
+            lastSite = lattice->addSite(xcrd, ycrd, occt, ent, nnmod);
+            siteIndex.insert(xcrd, ycrd, 9*lastSite);
+            for(int img = 1; img < 9; img++) {
+                int sx, sy;
+                Lattice::imageShift(img, &sx, &sy);
+                siteIndex.insert(xcrd + sx*xcell, ycrd + sy*ycell, 9*lastSite + img);
+            }
+        } else if(name == "Image") {
+            if(lastSite < 0) {
+                return xmlError(error, "Error. Malformed system file: Image outside Site");
+            }
+            int img = attributes.value("ImgNo").toString().toInt();
+            if(img > 0 && img < 9) {
+                double xcrd = attributes.value("xCoord").toString().toDouble();
+                double ycrd = attributes.value("yCoord").toString().toDouble();
+                siteIndex.insert(xcrd, ycrd, 9*lastSite + img);
+            }
+        } else if(name == "Transition") {
+            const char *names[8] = { "xStart", "yStart", "xEnd", "yEnd", "En", "startPF", "endPF", "ID" };
+            for(int a = 0; a < 8; a++) {
+                if(!attributes.hasAttribute(names[a])) {
+                    return xmlError(error, "Error. Malformed system file: Trans attributes missing");
+                }
+            }
+            XmlTransition trans;
+            trans.xs = attributes.value("xStart").toString().toDouble();
+            trans.ys = attributes.value("yStart").toString().toDouble();
+            trans.xe = attributes.value("xEnd").toString().toDouble();
+            trans.ye = attributes.value("yEnd").toString().toDouble();
+            trans.en = attributes.value("En").toString().toDouble();
+            trans.spf = attributes.value("startPF").toString().toDouble();
+            trans.epf = attributes.value("endPF").toString().toDouble();
+            trans.id = attributes.value("ID").toString().toInt();
+            transitions.append(trans);
+        }
+    }
+    if(xmlReader.hasError()) {
+        return xmlError(error, "Error reading XML file: " + xmlReader.errorString());
+    }
+
+    // resolve the transition end points against the coordinate index
+    foreach(const XmlTransition &trans, transitions) {
+        int start = siteIndex.find(trans.xs, trans.ys);
+        int end = siteIndex.find(trans.xe, trans.ye);
+        if(start == SiteIndex::Ambiguous || end == SiteIndex::Ambiguous) {
+            return xmlError(error, "Error. Malformed system file: ambiguous site coordinates");
+        }
+        if(start < 0 || end < 0) {
+            return xmlError(error, "Error. Malformed system file: hanging transition");
+        }
+        int ssx, ssy, esx, esy;
+        Lattice::imageShift(start % 9, &ssx, &ssy);
+        Lattice::imageShift(end % 9, &esx, &esy);
+        lattice->addTransition(start/9, end/9, trans.en, trans.spf, trans.epf,
+                               esx - ssx, esy - ssy, trans.id);
+    }
+
+    lattice->finalise();
+    return true;
+}
+
+// doubles are written with the fewest digits that read back exactly
+static QString number(double value)
+{
+    QString text = QString::number(value, 'g', 15);
+    if(text.toDouble() != value) text = QString::number(value, 'g', 17);
+    return text;
+}
+
+bool ModelIO::writeXml(const QString &filename, const Lattice &lattice, QString *error)
+{
+    QFile sfile(filename);
+    if (!sfile.open(QFile::WriteOnly | QFile::Truncate)) {
+        return xmlError(error, "Error writing XML file");
+    }
+
+    int xcell = lattice.xCell();
+    int ycell = lattice.yCell();
+
+    QXmlStreamWriter xmlWriter(&sfile);
+    xmlWriter.setAutoFormatting(true);
+    xmlWriter.writeStartDocument();
+    xmlWriter.writeStartElement("KMC2DData");
+    xmlWriter.writeAttribute("version", "v1.0");
+    xmlWriter.writeStartElement("Cell");
+    xmlWriter.writeAttribute("xDim", QString::number(xcell));
+    xmlWriter.writeAttribute("yDim", QString::number(ycell));
+    xmlWriter.writeEndElement();
+    xmlWriter.writeStartElement("ItemList");
+    for(int i = 0; i < lattice.siteCount(); i++) {
+        xmlWriter.writeStartElement("Site");
+        xmlWriter.writeAttribute("xCoord", number(lattice.x(i)));
+        xmlWriter.writeAttribute("yCoord", number(lattice.y(i)));
+        xmlWriter.writeAttribute("Occ", QString::number(lattice.occ(i)));
+        xmlWriter.writeAttribute("En", number(lattice.en(i)));
+        for(int nn = 1; nn < 7; nn++) {
+            xmlWriter.writeAttribute("Mod" + QString::number(nn), number(lattice.nnMod(i, nn)));
+        }
+        for(int img = 1; img < 9; img++) {
+            int sx, sy;
+            Lattice::imageShift(img, &sx, &sy);
+            xmlWriter.writeStartElement("Image");
+            xmlWriter.writeAttribute("xCoord", number(lattice.x(i) + sx*xcell));
+            xmlWriter.writeAttribute("yCoord", number(lattice.y(i) + sy*ycell));
+            xmlWriter.writeAttribute("ImgNo", QString::number(img));
+            xmlWriter.writeEndElement();
+        }
+        xmlWriter.writeEndElement();
+    }
+
+    // boundary transitions are written as the pathway to the end site image
+    // and its mirror from the start site image, linked by a shared ID
+    int indx = 1;
+    for(int t = 0; t < lattice.transCount(); t++) {
+        int start = lattice.transStart(t);
+        int end = lattice.transEnd(t);
+        double xs = lattice.x(start);
+        double ys = lattice.y(start);
+        double xe = lattice.x(end) + lattice.transShiftX(t)*xcell;
+        double ye = lattice.y(end) + lattice.transShiftY(t)*ycell;
+        bool boundary = lattice.transShiftX(t) != 0 || lattice.transShiftY(t) != 0;
+        int id = boundary ? indx++ : 0;
+        int ncopy = boundary ? 2 : 1;
+        for(int copy = 0; copy < ncopy; copy++) {
+            double shiftx = copy ? -lattice.transShiftX(t)*xcell : 0.0;
+            double shifty = copy ? -lattice.transShiftY(t)*ycell : 0.0;
+            xmlWriter.writeStartElement("Transition");
+            xmlWriter.writeAttribute("xStart", number(xs + shiftx));
+            xmlWriter.writeAttribute("yStart", number(ys + shifty));
+            xmlWriter.writeAttribute("xEnd", number(xe + shiftx));
+            xmlWriter.writeAttribute("yEnd", number(ye + shifty));
+            xmlWriter.writeAttribute("En", number(lattice.transEn(t)));
+            xmlWriter.writeAttribute("startPF", number(lattice.startPrefac(t)));
+            xmlWriter.writeAttribute("endPF", number(lattice.endPrefac(t)));
+            xmlWriter.writeAttribute("ID", QString::number(id));
+            xmlWriter.writeEndElement();
+        }
+    }
+    xmlWriter.writeEndElement();
+    xmlWriter.writeEndElement();
+    xmlWriter.writeEndDocument();
+    sfile.close();
+    return true;
+}
+
+// binary model layout: a fixed header followed by three blocks at 8 byte
+// aligned offsets, each holding whole arrays in native byte order
+//   sites:       x, y, en, nnmod[7] (double), occ (qint32)
+//   transitions: en, startPF, endPF (double), start, end, shiftX, shiftY (qint32)
+//   adjacency:   offset[nsites+1], trans[nadj], site[nadj] (qint32)
+struct BinaryHeader
+{
+    char magic[8];
+    quint32 byteOrder; // written as 0x01020304
+    quint32 version;
+    qint32 xcell;
+    qint32 ycell;
+    qint32 nsites;
+    qint32 ntrans;
+    qint32 nadj;
+    qint32 reserved;
+    qint64 siteOffset;
+    qint64 transOffset;
+    qint64 adjOffset;
+    qint64 fileSize;
+};
+
+Q_STATIC_ASSERT(sizeof(BinaryHeader) == 72);
+Q_STATIC_ASSERT(sizeof(int) == sizeof(qint32));
+
+static const char binaryMagic[8] = { 'K', 'M', 'C', '2', 'D', 'B', 'I', 'N' };
+
+static qint64 align8(qint64 size)
+{
+    return (size + 7) & ~qint64(7);
+}
+
+static qint64 siteBlockSize(qint64 nsites)
+{
+    return align8(nsites*10*sizeof(double) + nsites*sizeof(qint32));
+}
+
+static qint64 transBlockSize(qint64 ntrans)
+{
+    return align8(ntrans*3*sizeof(double) + ntrans*4*sizeof(qint32));
+}
+
+static qint64 adjBlockSize(qint64 nsites, qint64 nadj)
+{
+    return align8((nsites + 1 + 2*nadj)*sizeof(qint32));
+}
+
+// copy an array out of the mapped file and advance the read pointer
+template <typename T>
+static void readArray(const uchar **ptr, QVector<T> *array, int n)
+{
+    array->resize(n);
+    if(n > 0) memcpy(array->data(), *ptr, n*sizeof(T));
+    *ptr += n*sizeof(T);
+}
+
+template <typename T>
+static bool writeArray(QFile *file, const QVector<T> &array)
+{
+    qint64 size = array.size()*sizeof(T);
+    return size == 0 || file->write(reinterpret_cast<const char *>(array.constData()), size) == size;
+}
+
+static bool writePadding(QFile *file)
+{
+    static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    qint64 pad = align8(file->pos()) - file->pos();
+    return pad == 0 || file->write(zeros, pad) == pad;
+}
+
+bool ModelIO::readBinary(const QString &filename, Lattice *lattice, QString *error)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly)) {
+        return xmlError(error, "Error reading binary model file");
+    }
+    if(file.size() < qint64(sizeof(BinaryHeader))) {
+        return xmlError(error, "Error. Malformed binary model file: truncated header");
+    }
+
+    const uchar *data = file.map(0, file.size());
+    if(!data) {
+        return xmlError(error, "Error mapping binary model file");
+    }
+
+    BinaryHeader header;
+    memcpy(&header, data, sizeof(header));
+    if(memcmp(header.magic, binaryMagic, 8) != 0) {
+        return xmlError(error, "Error. Not a KMC2D binary model file");
+    }
+    if(header.byteOrder != 0x01020304) {
+        return xmlError(error, "Error. Binary model file has a different byte order");
+    }
+    if(header.version != binaryVersion) {
+        return xmlError(error, "Error. Unsupported binary model version " + QString::number(header.version));
+    }
+    qint64 nsites = header.nsites;
+    qint64 ntrans = header.ntrans;
+    qint64 nadj = header.nadj;
+    //the counts size int indexed arrays: 7*nsites neighbour modifiers is the largest
+    if(nsites < 0 || ntrans < 0 || nadj < 0 || nsites > (0x7fffffff - 1)/7 ||
+            header.siteOffset < qint64(sizeof(BinaryHeader)) ||
+            header.transOffset < header.siteOffset + siteBlockSize(nsites) ||
+            header.adjOffset < header.transOffset + transBlockSize(ntrans) ||
+            header.fileSize < header.adjOffset + adjBlockSize(nsites, nadj) ||
+            header.fileSize != file.size()) {
+        return xmlError(error, "Error. Malformed binary model file: bad block layout");
+    }
+    if(header.xcell <= 0 || header.ycell <= 0) {
+        return xmlError(error, "Error. Malformed binary model file: bad cell");
+    }
+
+    lattice->clear();
+    lattice->setCell(header.xcell, header.ycell);
+
+    const uchar *ptr = data + header.siteOffset;
+    readArray(&ptr, &lattice->m_x, nsites);
+    readArray(&ptr, &lattice->m_y, nsites);
+    readArray(&ptr, &lattice->m_en, nsites);
+    readArray(&ptr, &lattice->m_nnmod, 7*nsites);
+    readArray(&ptr, &lattice->m_occ, nsites);
+
+    ptr = data + header.transOffset;
+    readArray(&ptr, &lattice->m_transEn, ntrans);
+    readArray(&ptr, &lattice->m_startPF, ntrans);
+    readArray(&ptr, &lattice->m_endPF, ntrans);
+    readArray(&ptr, &lattice->m_transStart, ntrans);
+    readArray(&ptr, &lattice->m_transEnd, ntrans);
+    readArray(&ptr, &lattice->m_shiftX, ntrans);
+    readArray(&ptr, &lattice->m_shiftY, ntrans);
+
+    ptr = data + header.adjOffset;
+    readArray(&ptr, &lattice->m_adjOffset, nsites + 1);
+    readArray(&ptr, &lattice->m_adjTrans, nadj);
+    readArray(&ptr, &lattice->m_adjSite, nadj);
+    file.unmap(const_cast<uchar *>(data));
+
+    // the indices are trusted by the engine: check them once here
+    bool valid = lattice->m_adjOffset[0] == 0 && lattice->m_adjOffset[nsites] == nadj;
+    for(int i = 0; valid && i < nsites; i++) {
+        valid = lattice->m_adjOffset[i] <= lattice->m_adjOffset[i+1];
+        lattice->m_occ[i] = lattice->m_occ[i] ? 1 : 0;
+    }
+    for(int t = 0; valid && t < ntrans; t++) {
+        valid = lattice->m_transStart[t] >= 0 && lattice->m_transStart[t] < nsites &&
+                lattice->m_transEnd[t] >= 0 && lattice->m_transEnd[t] < nsites &&
+                qAbs(lattice->m_shiftX[t]) <= 1 && qAbs(lattice->m_shiftY[t]) <= 1;
+    }
+    //every adjacency entry of a site is a transition from or to it, paired
+    //with the site at its other end
+    for(int i = 0; valid && i < nsites; i++) {
+        for(int k = lattice->m_adjOffset[i]; valid && k < lattice->m_adjOffset[i+1]; k++) {
+            int t = lattice->m_adjTrans[k];
+            int j = lattice->m_adjSite[k];
+            valid = t >= 0 && t < ntrans &&
+                    ((lattice->m_transStart[t] == i && lattice->m_transEnd[t] == j) ||
+                     (lattice->m_transEnd[t] == i && lattice->m_transStart[t] == j));
+        }
+    }
+    if(!valid) {
+        lattice->clear();
+        return xmlError(error, "Error. Malformed binary model file: index out of range");
+    }
+
+    lattice->countNeighbours();
+    return true;
+}
+
+bool ModelIO::writeBinary(const QString &filename, const Lattice &lattice, QString *error)
+{
+    QFile file(filename);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        return xmlError(error, "Error writing binary model file");
+    }
+
+    qint64 nsites = lattice.siteCount();
+    qint64 ntrans = lattice.transCount();
+    qint64 nadj = lattice.m_adjTrans.size();
+
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, binaryMagic, 8);
+    header.byteOrder = 0x01020304;
+    header.version = binaryVersion;
+    header.xcell = lattice.xCell();
+    header.ycell = lattice.yCell();
+    header.nsites = nsites;
+    header.ntrans = ntrans;
+    header.nadj = nadj;
+    header.siteOffset = sizeof(BinaryHeader);
+    header.transOffset = header.siteOffset + siteBlockSize(nsites);
+    header.adjOffset = header.transOffset + transBlockSize(ntrans);
+    header.fileSize = header.adjOffset + adjBlockSize(nsites, nadj);
+
+    bool ok = file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == sizeof(header);
+    ok = ok && writeArray(&file, lattice.m_x) && writeArray(&file, lattice.m_y) &&
+            writeArray(&file, lattice.m_en) && writeArray(&file, lattice.m_nnmod) &&
+            writeArray(&file, lattice.m_occ) && writePadding(&file);
+    ok = ok && writeArray(&file, lattice.m_transEn) && writeArray(&file, lattice.m_startPF) &&
+            writeArray(&file, lattice.m_endPF) && writeArray(&file, lattice.m_transStart) &&
+            writeArray(&file, lattice.m_transEnd) && writeArray(&file, lattice.m_shiftX) &&
+            writeArray(&file, lattice.m_shiftY) && writePadding(&file);
+    ok = ok && writeArray(&file, lattice.m_adjOffset) && writeArray(&file, lattice.m_adjTrans) &&
+            writeArray(&file, lattice.m_adjSite) && writePadding(&file);
+    if(!ok || file.pos() != header.fileSize) {
+        return xmlError(error, "Error writing binary model file");
+    }
+    file.close();
+    return true;
+}
+
+bool ModelIO::isBinary(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly)) return false;
+    char magic[8];
+    return file.read(magic, 8) == 8 && memcmp(magic, binaryMagic, 8) == 0;
+}
+
+bool ModelIO::read(const QString &filename, Lattice *lattice, QString *error)
+{
+    if(isBinary(filename)) return readBinary(filename, lattice, error);
+    return readXml(filename, lattice, error);
+}
+
+bool ModelIO::write(const QString &filename, const Lattice &lattice, QString *error)
+{
+    if(QFileInfo(filename).suffix() == "kmcb") return writeBinary(filename, lattice, error);
+    return writeXml(filename, lattice, error);
+}
+
+// split a line in place at spaces, tabs, commas and semicolons
+static int splitFields(char *line, char **fields, int maxFields)
+{
+    int n = 0;
+    char *p = line;
+    while(*p && n < maxFields) {
+        while(*p == ' ' || *p == '\t' || *p == ',' || *p == ';' || *p == '\r' || *p == '\n') *p++ = 0;
+        if(!*p) break;
+        fields[n++] = p;
+        while(*p && *p != ' ' && *p != '\t' && *p != ',' && *p != ';' && *p != '\r' && *p != '\n') p++;
+    }
+    return n;
+}
+
+static bool parseNumber(const char *field, double *value)
+{
+    char *end;
+    *value = strtod(field, &end);
+    return end != field && *end == 0;
+}
+
+// the cell of an extended XYZ comment: Lattice="ax ay az bx by bz cx cy cz"
+static bool xyzCell(const QByteArray &comment, double *xcell, double *ycell)
+{
+    int start = comment.indexOf("Lattice=\"");
+    if(start < 0) return false;
+    start += 9;
+    int end = comment.indexOf('"', start);
+    QList<QByteArray> values = comment.mid(start, end - start).simplified().split(' ');
+    if(values.size() < 5) return false;
+    *xcell = values[0].toDouble();
+    *ycell = values[4].toDouble();
+    return *xcell > 0.0 && *ycell > 0.0;
+}
+
+bool ModelIO::importPoints(const QString &filename, Lattice *lattice, double scale, QString *error)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly)) {
+        return xmlError(error, "Error reading coordinate file");
+    }
+    if(scale <= 0.0) {
+        return xmlError(error, "Error. The coordinate scale must be positive");
+    }
+    bool xyz = QFileInfo(filename).suffix().toLower() == "xyz";
+
+    //columns of x, y, energy and occupation
+    enum { X, Y, En, Occ };
+    int column[4] = { 0, 1, 2, 3 };
+    if(xyz) {
+        column[X] = 1;
+        column[Y] = 2;
+        column[En] = 4;
+        column[Occ] = 5;
+    }
+
+    double xcell = 0.0;
+    double ycell = 0.0;
+    bool header = !xyz;
+    qint64 natoms = -1; // only the first frame of an XYZ file is read
+    QVector<double> x;
+    QVector<double> y;
+    QVector<double> en;
+    QVector<int> occ;
+    const int maxFields = 32;
+    char *fields[maxFields];
+    QByteArray line(4096, 0);
+    qint64 lineNumber = 0;
+    qint64 size;
+    while((size = file.readLine(line.data(), line.size())) > 0) {
+        lineNumber++;
+        if(size == line.size() - 1 && line[int(size) - 1] != '\n') {
+            return xmlError(error, "Error. Line " + QString::number(lineNumber) + " is too long");
+        }
+        if(xyz && lineNumber <= 2) {
+            //atom count, then the comment line
+            if(lineNumber == 1) natoms = QByteArray(line.constData(), int(size)).trimmed().toLongLong();
+            if(lineNumber == 2) xyzCell(QByteArray(line.constData(), int(size)), &xcell, &ycell);
+            continue;
+        }
+        if(line[0] == '#') {
+            double cx, cy;
+            if(sscanf(line.constData(), "# cell %lf %lf", &cx, &cy) == 2 && cx > 0.0 && cy > 0.0) {
+                xcell = cx;
+                ycell = cy;
+            }
+            continue;
+        }
+        int n = splitFields(line.data(), fields, maxFields);
+        if(n == 0) continue;
+
+        double value[4] = { 0.0, 0.0, 0.0, 0.0 };
+        if(header) {
+            header = false;
+            double number;
+            if(!parseNumber(fields[0], &number)) {
+                //named columns: unknown names are skipped
+                column[En] = column[Occ] = -1;
+                for(int k = 0; k < n; k++) {
+                    QByteArray name = QByteArray(fields[k]).toLower();
+                    if(name == "x") column[X] = k;
+                    if(name == "y") column[Y] = k;
+                    if(name == "energy" || name == "en") column[En] = k;
+                    if(name == "occ" || name == "occupation") column[Occ] = k;
+                }
+                continue;
+            }
+        }
+        for(int c = 0; c < 4; c++) {
+            if(column[c] < 0 || column[c] >= n) {
+                if(c == X || c == Y) {
+                    return xmlError(error, "Error. Missing coordinate on line " + QString::number(lineNumber));
+                }
+            } else if(!parseNumber(fields[column[c]], &value[c])) {
+                return xmlError(error, "Error. Bad number on line " + QString::number(lineNumber));
+            }
+        }
+        x.append(value[X]*scale);
+        y.append(value[Y]*scale);
+        en.append(value[En]);
+        occ.append(value[Occ] != 0.0);
+        if(x.size() == natoms) break;
+    }
+    if(x.isEmpty()) {
+        return xmlError(error, "Error. No sites in coordinate file");
+    }
+
+    //without a cell the sites are moved into their bounding box, padded by
+    //half the mean site spacing
+    //the cell of the file is kept as it is: rounding it would change the
+    //periodic images of every site near the edges
+    double xmin = 0.0;
+    double ymin = 0.0;
+    if(xcell > 0.0) {
+        xcell *= scale;
+        ycell *= scale;
+        if(qAbs(xcell - qRound64(xcell)) > 1.0e-6*qMax(1.0, xcell) ||
+                qAbs(ycell - qRound64(ycell)) > 1.0e-6*qMax(1.0, ycell)) {
+            return xmlError(error, "Error. The cell in the coordinate file is " + QString::number(xcell) + " x " +
+                            QString::number(ycell) + " scene units: the scale must make it whole");
+        }
+        xcell = qRound64(xcell);
+        ycell = qRound64(ycell);
+    } else {
+        xmin = x[0];
+        ymin = y[0];
+        double xmax = x[0];
+        double ymax = y[0];
+        for(int i = 1; i < x.size(); i++) {
+            xmin = qMin(xmin, x[i]);
+            xmax = qMax(xmax, x[i]);
+            ymin = qMin(ymin, y[i]);
+            ymax = qMax(ymax, y[i]);
+        }
+        double spacing = qSqrt(qMax(xmax - xmin, 1.0)*qMax(ymax - ymin, 1.0)/x.size());
+        xmin -= 0.5*spacing;
+        ymin -= 0.5*spacing;
+        xcell = xmax + 0.5*spacing - xmin;
+        ycell = ymax + 0.5*spacing - ymin;
+    }
+    int ixcell = qCeil(xcell);
+    int iycell = qCeil(ycell);
+    if(ixcell < 1 || iycell < 1 || xcell > 1.0e9 || ycell > 1.0e9) {
+        return xmlError(error, "Error. Invalid cell in coordinate file");
+    }
+
+    lattice->clear();
+    lattice->setCell(ixcell, iycell);
+    for(int i = 0; i < x.size(); i++) {
+        double xi = x[i] - xmin;
+        double yi = y[i] - ymin;
+        xi -= qFloor(xi/ixcell)*ixcell;
+        yi -= qFloor(yi/iycell)*iycell;
+        lattice->addSite(xi, yi, occ[i], en[i], 0);
+    }
+    lattice->finalise();
+    return true;
+}
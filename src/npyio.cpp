@@ -0,0 +1,268 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "npyio.h"
+
+#include <QtEndian>
+
+static const int npyHeaderSize = 128;
+
+static void put16(QByteArray *data, quint16 value)
+{
+    uchar bytes[2];
+    qToLittleEndian(value, bytes);
+    data->append(reinterpret_cast<const char *>(bytes), 2);
+}
+
+static void put32(QByteArray *data, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    data->append(reinterpret_cast<const char *>(bytes), 4);
+}
+
+// zip (IEEE 802.3) CRC-32
+static quint32 crc32(quint32 crc, const char *data, qint64 size)
+{
+    static quint32 table[256];
+    static bool tableValid = false;
+    if(!tableValid) {
+        for(quint32 n = 0; n < 256; n++) {
+            quint32 c = n;
+            for(int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320U ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        tableValid = true;
+    }
+    crc = ~crc;
+    for(qint64 i = 0; i < size; i++) {
+        crc = table[(crc ^ uchar(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+NpyFile::NpyFile()
+{
+    m_count = 0;
+    m_failed = false;
+}
+
+NpyFile::~NpyFile()
+{
+    close();
+}
+
+//version 1.0 header padded with spaces to a fixed size, so that the shape
+//can be filled in after the data
+QByteArray NpyFile::header(qint64 count)
+{
+    QByteArray dict = "{'descr': '";
+    dict += Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? "<f8" : ">f8";
+    dict += "', 'fortran_order': False, 'shape': (" + QByteArray::number(count) + ",), }";
+    while(dict.size() < npyHeaderSize - 11) dict += ' ';
+    dict += '\n';
+
+    QByteArray data("\x93NUMPY\x01\x00", 8);
+    put16(&data, dict.size());
+    data += dict;
+    return data;
+}
+
+bool NpyFile::open(const QString &filename, qint64 keep, QString *error)
+{
+    close();
+    m_file.setFileName(filename);
+    m_count = 0;
+    m_failed = false;
+    if(keep > 0) {
+        qint64 size = npyHeaderSize + keep*qint64(sizeof(double));
+        if(!m_file.open(QFile::ReadWrite) || m_file.size() < size ||
+                !m_file.resize(size) || !m_file.seek(size)) {
+            m_file.close();
+            if(error) *error = "Error appending to array file " + filename;
+            return false;
+        }
+        m_count = keep;
+    } else if(!m_file.open(QFile::WriteOnly | QFile::Truncate) || m_file.write(header(0)) != npyHeaderSize) {
+        m_file.close();
+        if(error) *error = "Error writing array file " + filename;
+        return false;
+    }
+    m_block.reserve(BlockSize);
+    return true;
+}
+
+void NpyFile::append(double value)
+{
+    m_block.append(value);
+    m_count++;
+    if(m_block.size() >= BlockSize) flush();
+}
+
+void NpyFile::flush()
+{
+    qint64 size = m_block.size()*sizeof(double);
+    if(m_file.write(reinterpret_cast<const char *>(m_block.constData()), size) != size) m_failed = true;
+    m_block.clear();
+}
+
+bool NpyFile::close(QString *error)
+{
+    if(!m_file.isOpen()) return true;
+    flush();
+    m_file.seek(0);
+    if(m_file.write(header(m_count)) != npyHeaderSize) m_failed = true;
+    m_file.close();
+    m_block = QVector<double>();
+    if(m_failed && error) *error = "Error writing array file " + m_file.fileName();
+    return !m_failed;
+}
+
+NpzWriter::NpzWriter()
+{
+    m_failed = false;
+}
+
+NpzWriter::~NpzWriter()
+{
+    close();
+}
+
+bool NpzWriter::open(const QString &filename, QString *error)
+{
+    close();
+    m_file.setFileName(filename);
+    m_entries.clear();
+    m_failed = false;
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate)) {
+        if(error) *error = "Error writing archive " + filename;
+        return false;
+    }
+    return true;
+}
+
+//local header: the crc and size are filled in by endEntry
+bool NpzWriter::beginEntry(const QString &name)
+{
+    if(m_file.pos() > 0xffffffffLL) m_failed = true;
+    if(m_failed) return false;
+
+    Entry entry;
+    entry.name = name.toUtf8() + ".npy";
+    entry.crc = 0;
+    entry.size = 0;
+    entry.offset = quint32(m_file.pos());
+    m_entries.append(entry);
+
+    QByteArray local;
+    put32(&local, 0x04034b50);
+    put16(&local, 20); // version needed: 2.0
+    put16(&local, 0); // flags
+    put16(&local, 0); // stored
+    put16(&local, 0); // time
+    put16(&local, 0x21); // date: 1 Jan 1980
+    put32(&local, 0);
+    put32(&local, 0);
+    put32(&local, 0);
+    put16(&local, entry.name.size());
+    put16(&local, 0);
+    local += entry.name;
+    if(m_file.write(local) != local.size()) m_failed = true;
+    return !m_failed;
+}
+
+void NpzWriter::addData(const char *data, qint64 size)
+{
+    Entry &entry = m_entries.last();
+    entry.crc = crc32(entry.crc, data, size);
+    if(entry.size + quint64(size) > 0xffffffffULL) m_failed = true;
+    entry.size += size;
+    if(m_file.write(data, size) != size) m_failed = true;
+}
+
+bool NpzWriter::endEntry()
+{
+    const Entry &entry = m_entries.last();
+    QByteArray sizes;
+    put32(&sizes, entry.crc);
+    put32(&sizes, entry.size);
+    put32(&sizes, entry.size);
+    qint64 end = m_file.pos();
+    if(!m_file.seek(entry.offset + 14) || m_file.write(sizes) != sizes.size() || !m_file.seek(end)) {
+        m_failed = true;
+    }
+    return !m_failed;
+}
+
+bool NpzWriter::addArray(const QString &name, const QVector<double> &values)
+{
+    if(!beginEntry(name)) return false;
+    QByteArray header = NpyFile::header(values.size());
+    addData(header.constData(), header.size());
+    addData(reinterpret_cast<const char *>(values.constData()), values.size()*sizeof(double));
+    return endEntry();
+}
+
+bool NpzWriter::addFile(const QString &name, const QString &npyFile)
+{
+    QFile file(npyFile);
+    if (!file.open(QFile::ReadOnly)) {
+        m_failed = true;
+        return false;
+    }
+    if(!beginEntry(name)) return false;
+    QByteArray block(1 << 20, 0);
+    qint64 n;
+    while((n = file.read(block.data(), block.size())) > 0) {
+        addData(block.constData(), n);
+    }
+    if(n < 0) m_failed = true;
+    return endEntry();
+}
+
+//central directory and end record
+bool NpzWriter::close(QString *error)
+{
+    if(!m_file.isOpen()) return true;
+    qint64 start = m_file.pos();
+    QByteArray directory;
+    foreach(const Entry &entry, m_entries) {
+        put32(&directory, 0x02014b50);
+        put16(&directory, 20); // made by
+        put16(&directory, 20); // needed
+        put16(&directory, 0);
+        put16(&directory, 0);
+        put16(&directory, 0);
+        put16(&directory, 0x21);
+        put32(&directory, entry.crc);
+        put32(&directory, entry.size);
+        put32(&directory, entry.size);
+        put16(&directory, entry.name.size());
+        put16(&directory, 0); // extra
+        put16(&directory, 0); // comment
+        put16(&directory, 0); // disk
+        put16(&directory, 0); // internal attributes
+        put32(&directory, 0); // external attributes
+        put32(&directory, entry.offset);
+        directory += entry.name;
+    }
+    quint32 size = directory.size();
+    put32(&directory, 0x06054b50);
+    put16(&directory, 0);
+    put16(&directory, 0);
+    put16(&directory, m_entries.size());
+    put16(&directory, m_entries.size());
+    put32(&directory, size);
+    put32(&directory, quint32(start));
+    put16(&directory, 0);
+    if(start > 0xffffffffLL || m_file.write(directory) != directory.size()) m_failed = true;
+    m_file.close();
+    if(m_failed && error) *error = "Error writing archive " + m_file.fileName() + " (entries are limited to 4 GB)";
+    return !m_failed;
+}
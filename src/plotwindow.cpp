@@ -13,15 +13,16 @@
 
 #include "plotwindow.h"
 #include "qcustomplot.h"
+#include "seriesrecorder.h"
+#include "npyio.h"
 
-PlotWindow::PlotWindow(QVector<double> *e1, QVector<double> *t1,
-                       QVector<double> *x1, QVector<double> *y1, QVector<double> *s1)
+PlotWindow::PlotWindow(const SeriesRecorder *series)
 {
-    time = t1;
-    energy = e1;
-    xDisp = x1;
-    yDisp = y1;
-    sDisp = s1;
+    time = series->series(SeriesRecorder::Time);
+    energy = series->series(SeriesRecorder::Energy);
+    xDisp = series->series(SeriesRecorder::XDisp);
+    yDisp = series->series(SeriesRecorder::YDisp);
+    sDisp = series->series(SeriesRecorder::SqDisp);
 
     customPlot = new QCustomPlot(this);
     // add two new graphs and set their look:
@@ -36,7 +37,7 @@ PlotWindow::PlotWindow(QVector<double> *e1, QVector<double> *t1,
     connect(customPlot->xAxis, SIGNAL(rangeChanged(QCPRange)), customPlot->xAxis2, SLOT(setRange(QCPRange)));
     connect(customPlot->yAxis, SIGNAL(rangeChanged(QCPRange)), customPlot->yAxis2, SLOT(setRange(QCPRange)));
     // pass data points to graphs:
-    customPlot->graph(0)->setData(*time, *energy);
+    customPlot->graph(0)->setData(time, energy);
     customPlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom | QCP::iSelectPlottables);
 
     customPlot->setMinimumWidth(600);
@@ -92,9 +93,27 @@ void PlotWindow::saveButtonPress()
 
 void PlotWindow::exportButtonPress()
 {
+    QString filter;
     QString savefile = QFileDialog::getSaveFileName(this, "Export plot data",
                                                     QString(),
-                                                    "DAT Files (*.dat)");
+                                                    "DAT Files (*.dat);;NumPy Archives (*.npz)", &filter);
+
+    //binary columns: one float64 array per series, read by numpy.load
+    if (!savefile.isNull() && (filter.contains("*.npz") || QFileInfo(savefile).suffix() == "npz")) {
+        const QVector<double> *columns[SeriesRecorder::ColumnCount] = { &time, &energy, &xDisp, &yDisp, &sDisp };
+        NpzWriter archive;
+        QString error;
+        bool ok = archive.open(savefile, &error);
+        for(int c = 0; ok && c < SeriesRecorder::ColumnCount; c++) {
+            ok = archive.addArray(SeriesRecorder::columnName(SeriesRecorder::Column(c)), *columns[c]);
+        }
+        if(!archive.close(&error) || !ok) {
+            QMessageBox msgbox;
+            msgbox.setText(error);
+            msgbox.exec();
+        }
+        return;
+    }
 
     if (!savefile.isNull()) {
 
@@ -103,9 +122,9 @@ void PlotWindow::exportButtonPress()
         {
             QTextStream out(&sfile);
             out << "Time Energy xDisp yDisp Sq.Disp\n";
-            for(int count = 0; count < time->size(); count++) {
-               out << time->value(count) << " " << energy->value(count) << " " << xDisp->value(count) << " " <<
-                      yDisp->value(count) << " " << sDisp->value(count) << "\n";
+            for(int count = 0; count < time.size(); count++) {
+               out << time.value(count) << " " << energy.value(count) << " " << xDisp.value(count) << " " <<
+                      yDisp.value(count) << " " << sDisp.value(count) << "\n";
             }
             sfile.close();
         } else
@@ -131,19 +150,19 @@ void PlotWindow::setPlotType()
     if(ptype == 0) {
         customPlot->graph(0)->clearData();
         customPlot->graph(0)->setPen(QPen(Qt::red));
-        customPlot->graph(0)->setData(*time, *energy);
+        customPlot->graph(0)->setData(time, energy);
     } else if(ptype == 1) {
         customPlot->graph(0)->clearData();
         customPlot->graph(0)->setPen(QPen(Qt::black));
-        customPlot->graph(0)->setData(*time, *xDisp);
+        customPlot->graph(0)->setData(time, xDisp);
     } else if(ptype == 2) {
         customPlot->graph(0)->clearData();
         customPlot->graph(0)->setPen(QPen(Qt::black));
-        customPlot->graph(0)->setData(*time, *yDisp);
+        customPlot->graph(0)->setData(time, yDisp);
     } else if(ptype == 3) {
         customPlot->graph(0)->clearData();
         customPlot->graph(0)->setPen(QPen(Qt::blue));
-        customPlot->graph(0)->setData(*time, *sDisp);
+        customPlot->graph(0)->setData(time, sDisp);
     }
 }
 
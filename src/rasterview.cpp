@@ -0,0 +1,386 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "rasterview.h"
+#include "lattice.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <QSet>
+#include <QtMath>
+
+#include <algorithm>
+
+static const double siteRadius = 28.0; // scene site disc and pen
+
+RasterView::RasterView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    m_xcell = 1;
+    m_ycell = 1;
+    m_minEn = 0.0;
+    m_maxEn = 0.0;
+    m_highlight = -1;
+    m_mode = Occupation;
+    m_binSize = 1.0;
+    m_nbx = 1;
+    m_nby = 1;
+    m_binOffset.fill(0, 2);
+    m_level = -1;
+    m_scale = 1.0;
+    m_width = 1;
+    m_height = 1;
+    m_refreshed = 0;
+    viewport()->setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+//copy the sites and bin them so that each tile only visits the sites it covers
+void RasterView::setLattice(const Lattice &lattice)
+{
+    int nsites = lattice.siteCount();
+    m_xcell = qMax(1, lattice.xCell());
+    m_ycell = qMax(1, lattice.yCell());
+    m_x.resize(nsites);
+    m_y.resize(nsites);
+    m_en.resize(nsites);
+    m_occ.resize(nsites);
+    for(int i = 0; i < nsites; i++) {
+        m_x[i] = lattice.x(i);
+        m_y[i] = lattice.y(i);
+        m_en[i] = lattice.en(i);
+        m_occ[i] = lattice.occ(i);
+        m_minEn = i == 0 ? m_en[i] : qMin(m_minEn, m_en[i]);
+        m_maxEn = i == 0 ? m_en[i] : qMax(m_maxEn, m_en[i]);
+    }
+    m_highlight = -1;
+
+    //about four sites to a bin
+    m_binSize = qMax(1.0, qSqrt(4.0*m_xcell*m_ycell/qMax(1, nsites)));
+    m_nbx = qMax(1, qCeil(m_xcell/m_binSize));
+    m_nby = qMax(1, qCeil(m_ycell/m_binSize));
+    QVector<int> siteBin(nsites);
+    m_binOffset.fill(0, m_nbx*m_nby + 1);
+    for(int i = 0; i < nsites; i++) {
+        int bx = qBound(0, int(m_x[i]/m_binSize), m_nbx - 1);
+        int by = qBound(0, int(m_y[i]/m_binSize), m_nby - 1);
+        siteBin[i] = by*m_nbx + bx;
+        m_binOffset[siteBin[i] + 1]++;
+    }
+    for(int b = 0; b < m_nbx*m_nby; b++) {
+        m_binOffset[b+1] += m_binOffset[b];
+    }
+    m_binSites.resize(nsites);
+    QVector<int> fill = m_binOffset;
+    for(int i = 0; i < nsites; i++) {
+        m_binSites[fill[siteBin[i]]++] = i;
+    }
+
+    m_width = int(qMin(m_xcell*m_scale, 1.0e9)) + 1;
+    m_height = int(qMin(m_ycell*m_scale, 1.0e9)) + 1;
+    clearTiles();
+    updateScrollBars();
+    viewport()->update();
+}
+
+void RasterView::setSite(int i, bool occ)
+{
+    if(i < 0 || i >= m_occ.size() || bool(m_occ[i]) == occ) return;
+    m_occ[i] = occ;
+    if(m_changed.size() > m_occ.size()/4) {
+        //the tiles will be drawn again anyway
+        clearTiles();
+        viewport()->update();
+        return;
+    }
+    m_changed.append(i);
+}
+
+void RasterView::setHighlight(int i)
+{
+    if(i == m_highlight) return;
+    if(m_highlight >= 0) m_changed.append(m_highlight);
+    m_highlight = i < m_occ.size() ? i : -1;
+    if(m_highlight >= 0) m_changed.append(m_highlight);
+}
+
+//a few sites are invalidated one by one, more by the visible tiles that
+//hold them, so the region stays small however busy the frame
+void RasterView::refresh()
+{
+    if(m_refreshed >= m_changed.size()) return;
+    QPoint corner = origin();
+    QRect visible = viewport()->rect().translated(-corner);
+    QRegion region;
+    if(m_changed.size() - m_refreshed <= 64) {
+        for(int k = m_refreshed; k < m_changed.size(); k++) {
+            region += (siteRect(m_changed[k]) & visible).translated(corner);
+        }
+    } else {
+        QSet<quint64> tiles;
+        for(int k = m_refreshed; k < m_changed.size(); k++) {
+            QRect rect = siteRect(m_changed[k]) & visible;
+            if(rect.isEmpty()) continue;
+            for(int ty = rect.top()/TileSize; ty <= rect.bottom()/TileSize; ty++) {
+                for(int tx = rect.left()/TileSize; tx <= rect.right()/TileSize; tx++) {
+                    tiles.insert((quint64(ty) << 24) | quint64(tx));
+                }
+            }
+        }
+        foreach(quint64 key, tiles) {
+            QRect rect(int(key & 0xffffff)*TileSize, int(key >> 24)*TileSize, TileSize, TileSize);
+            region += (rect & visible).translated(corner);
+        }
+    }
+    m_refreshed = m_changed.size();
+    viewport()->update(region);
+}
+
+void RasterView::setColorMode(ColorMode mode)
+{
+    if(mode == m_mode) return;
+    m_mode = mode;
+    clearTiles();
+    viewport()->update();
+}
+
+//the tiles of each zoom level are kept: zooming back is a cache hit as long
+//as no site has changed in between
+void RasterView::setZoom(int level, double scale)
+{
+    if(level == m_level) return;
+    //keep the scene point at the centre of the viewport
+    QPointF centre = QPointF(viewport()->width()/2, viewport()->height()/2) - origin();
+    centre /= m_scale;
+
+    m_level = level;
+    m_scale = scale;
+    m_width = int(qMin(m_xcell*m_scale, 1.0e9)) + 1;
+    m_height = int(qMin(m_ycell*m_scale, 1.0e9)) + 1;
+    updateScrollBars();
+    horizontalScrollBar()->setValue(qRound(centre.x()*m_scale - viewport()->width()/2));
+    verticalScrollBar()->setValue(qRound(centre.y()*m_scale - viewport()->height()/2));
+    viewport()->update();
+}
+
+void RasterView::paintEvent(QPaintEvent *event)
+{
+    //changes not yet invalidated are drawn into the tiles now and shown by
+    //the update this schedules
+    refresh();
+    flushChanges();
+
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), Qt::lightGray);
+
+    QPoint corner = origin();
+    QRect area = event->rect().translated(-corner) & QRect(0, 0, m_width, m_height);
+    if(area.isEmpty()) return;
+    for(int ty = area.top()/TileSize; ty <= area.bottom()/TileSize; ty++) {
+        for(int tx = area.left()/TileSize; tx <= area.right()/TileSize; tx++) {
+            painter.drawImage(corner + QPoint(tx*TileSize, ty*TileSize), *tile(tx, ty));
+        }
+    }
+}
+
+void RasterView::resizeEvent(QResizeEvent *)
+{
+    updateScrollBars();
+}
+
+void RasterView::scrollContentsBy(int, int)
+{
+    viewport()->update();
+}
+
+//the level is masked so the -1 before the first zoom gives the same key
+//bits that the purges below compare against
+quint64 RasterView::tileKey(int tx, int ty) const
+{
+    return (quint64(quint16(m_level)) << 48) | (quint64(ty) << 24) | quint64(tx);
+}
+
+//the cached tile at the current zoom level, or a new one with every site
+//within a disc radius of it
+QImage *RasterView::tile(int tx, int ty)
+{
+    quint64 key = tileKey(tx, ty);
+    QHash<quint64, QImage>::iterator it = m_tiles.find(key);
+    if(it != m_tiles.end()) return &it.value();
+
+    //a full cache drops the other zoom levels first, then everything
+    if(m_tiles.size() >= MaxTiles) {
+        it = m_tiles.begin();
+        while(it != m_tiles.end()) {
+            if((it.key() >> 48) != quint16(m_level)) {
+                it = m_tiles.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if(m_tiles.size() >= MaxTiles) m_tiles.clear();
+    }
+
+    int left = tx*TileSize;
+    int top = ty*TileSize;
+    QImage image(TileSize, TileSize, QImage::Format_RGB32);
+    QPainter painter(&image);
+    drawArea(&image, &painter, QRect(left, top, TileSize, TileSize), left, top);
+    painter.end();
+
+    return &m_tiles.insert(key, image).value();
+}
+
+//draw the background and every site reaching into an area of the cell
+//(pixels) as a new tile would have it: neighbouring discs overlap, so a
+//changed site is redrawn together with the sites around it
+void RasterView::drawArea(QImage *image, QPainter *painter, const QRect &area, int left, int top) const
+{
+    QRect clip = area.translated(-left, -top);
+    painter->setClipRect(clip);
+    painter->fillRect(clip, Qt::lightGray);
+    painter->fillRect(QRect(-left, -top, m_width, m_height), Qt::white);
+
+    double margin = siteRadius + 1.0/m_scale;
+    int bx0 = qBound(0, qFloor((area.left()/m_scale - margin)/m_binSize), m_nbx - 1);
+    int bx1 = qBound(0, qFloor(((area.right() + 1)/m_scale + margin)/m_binSize), m_nbx - 1);
+    int by0 = qBound(0, qFloor((area.top()/m_scale - margin)/m_binSize), m_nby - 1);
+    int by1 = qBound(0, qFloor(((area.bottom() + 1)/m_scale + margin)/m_binSize), m_nby - 1);
+    for(int by = by0; by <= by1; by++) {
+        for(int bx = bx0; bx <= bx1; bx++) {
+            int b = by*m_nbx + bx;
+            for(int m = m_binOffset[b]; m < m_binOffset[b+1]; m++) {
+                int i = m_binSites[m];
+                if(siteRect(i).intersects(area)) drawSite(image, painter, i, left, top, clip);
+            }
+        }
+    }
+}
+
+//small discs are written straight into the image, larger ones are drawn
+//with the outline of the scene sites
+void RasterView::drawSite(QImage *image, QPainter *painter, int i, int left, int top, const QRect &clip) const
+{
+    QRect rect = siteRect(i).translated(-left, -top);
+    QRgb rgb = color(i);
+    if(rect.width() <= 3) {
+        QRect pixels = rect & clip;
+        for(int y = pixels.top(); y <= pixels.bottom(); y++) {
+            QRgb *line = reinterpret_cast<QRgb *>(image->scanLine(y));
+            for(int x = pixels.left(); x <= pixels.right(); x++) line[x] = rgb;
+        }
+        return;
+    }
+    if(rect.width() >= 8) {
+        painter->setPen(QPen(Qt::darkGray, qMax(1.0, 7.0*m_scale)));
+    } else {
+        painter->setPen(Qt::NoPen);
+    }
+    painter->setBrush(QColor(rgb));
+    painter->drawEllipse(rect);
+}
+
+//draw the changed sites and the neighbours under them into the cached tiles
+//of this zoom level: the other levels are out of date and dropped
+void RasterView::flushChanges()
+{
+    if(m_changed.isEmpty()) return;
+
+    QHash<quint64, QImage>::iterator it = m_tiles.begin();
+    while(it != m_tiles.end()) {
+        if((it.key() >> 48) != quint16(m_level)) {
+            it = m_tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    //drawing the visible tiles again is cheaper than a large fraction of the sites
+    if(m_tiles.isEmpty() || m_changed.size() > m_occ.size()/4) {
+        clearTiles();
+        return;
+    }
+
+    //group the changes by tile so each tile is painted once
+    QVector<QPair<quint64, int> > updates;
+    updates.reserve(m_changed.size());
+    foreach(int i, m_changed) {
+        QRect rect = siteRect(i);
+        for(int ty = qMax(0, rect.top()/TileSize); ty <= rect.bottom()/TileSize; ty++) {
+            for(int tx = qMax(0, rect.left()/TileSize); tx <= rect.right()/TileSize; tx++) {
+                updates.append(qMakePair(tileKey(tx, ty), i));
+            }
+        }
+    }
+    m_changed.clear();
+    m_refreshed = 0;
+    std::sort(updates.begin(), updates.end());
+
+    for(int k = 0; k < updates.size(); ) {
+        quint64 key = updates[k].first;
+        int end = k;
+        while(end < updates.size() && updates[end].first == key) end++;
+        it = m_tiles.find(key);
+        if(it != m_tiles.end()) {
+            QImage *image = &it.value();
+            int left = int(key & 0xffffff)*TileSize;
+            int top = int((key >> 24) & 0xffffff)*TileSize;
+            QRect bounds(left, top, TileSize, TileSize);
+            QPainter painter(image);
+            for(int m = k; m < end; m++) {
+                drawArea(image, &painter, siteRect(updates[m].second) & bounds, left, top);
+            }
+        }
+        k = end;
+    }
+}
+
+void RasterView::clearTiles()
+{
+    m_tiles.clear();
+    m_changed.clear();
+    m_refreshed = 0;
+}
+
+void RasterView::updateScrollBars()
+{
+    QSize size = viewport()->size();
+    horizontalScrollBar()->setRange(0, qMax(0, m_width - size.width()));
+    horizontalScrollBar()->setPageStep(size.width());
+    horizontalScrollBar()->setSingleStep(TileSize/8);
+    verticalScrollBar()->setRange(0, qMax(0, m_height - size.height()));
+    verticalScrollBar()->setPageStep(size.height());
+    verticalScrollBar()->setSingleStep(TileSize/8);
+}
+
+//a cell smaller than the viewport is centred in it
+QPoint RasterView::origin() const
+{
+    QSize size = viewport()->size();
+    int x = m_width < size.width() ? (size.width() - m_width)/2 : -horizontalScrollBar()->value();
+    int y = m_height < size.height() ? (size.height() - m_height)/2 : -verticalScrollBar()->value();
+    return QPoint(x, y);
+}
+
+QRect RasterView::siteRect(int i) const
+{
+    int d = qMax(1, qRound(2.0*siteRadius*m_scale));
+    return QRect(qFloor(m_x[i]*m_scale - 0.5*d), qFloor(m_y[i]*m_scale - 0.5*d), d, d);
+}
+
+//the scene colours: occupied sites dark, the last event's site red, or the
+//site energy from blue (low) to red (high) darkened when occupied
+QRgb RasterView::color(int i) const
+{
+    if(i == m_highlight) return qRgb(235, 0, 0);
+    if(m_mode == SiteEnergy) {
+        double f = m_maxEn > m_minEn ? (m_en[i] - m_minEn)/(m_maxEn - m_minEn) : 0.5;
+        return QColor::fromHsvF((1.0 - f)*2.0/3.0, 0.8, m_occ[i] ? 0.55 : 1.0).rgb();
+    }
+    return m_occ[i] ? qRgb(128, 128, 128) : qRgb(218, 218, 218);
+}
@@ -0,0 +1,210 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "rateclasses.h"
+
+#include <string.h>
+
+RateClassSelector::RateClassSelector()
+{
+    resize(0);
+}
+
+void RateClassSelector::resize(int n)
+{
+    m_rate.fill(0.0, n);
+    m_class.fill(-1, n);
+    m_slot.fill(-1, n);
+    m_classRate.clear();
+    m_members.clear();
+    m_classIndex.clear();
+    m_active.clear();
+    m_activeSlot.clear();
+    m_free.clear();
+    m_total = 0.0;
+    m_totalValid = true;
+}
+
+void RateClassSelector::setRates(const QVector<double> &rates)
+{
+    resize(rates.size());
+    for(int i = 0; i < rates.size(); i++) {
+        setRate(i, rates[i]);
+    }
+}
+
+//find (or create) the class for a rate: a new class reuses an emptied one and
+//joins the end of the scan
+int RateClassSelector::classOf(double rate)
+{
+    quint64 key;
+    memcpy(&key, &rate, sizeof(key));
+    int c = m_classIndex.value(key, -1);
+    if(c < 0) {
+        if(m_free.isEmpty()) {
+            c = m_classRate.size();
+            m_classRate.append(rate);
+            m_members.append(QVector<int>());
+            m_activeSlot.append(-1);
+        } else {
+            c = m_free.last();
+            m_free.removeLast();
+            m_classRate[c] = rate;
+        }
+        m_classIndex.insert(key, c);
+        m_activeSlot[c] = m_active.size();
+        m_active.append(c);
+    }
+    return c;
+}
+
+//drop an empty class: swap-remove it from the scan and free it for reuse
+void RateClassSelector::removeClass(int c)
+{
+    quint64 key;
+    memcpy(&key, &m_classRate[c], sizeof(key));
+    m_classIndex.remove(key);
+    int moved = m_active.last();
+    m_active[m_activeSlot[c]] = moved;
+    m_activeSlot[moved] = m_activeSlot[c];
+    m_active.removeLast();
+    m_activeSlot[c] = -1;
+    m_free.append(c);
+}
+
+//move an event to the class of its new rate: swap-remove from the old class
+void RateClassSelector::setRate(int i, double rate)
+{
+    if(rate == m_rate[i]) return;
+
+    int c = m_class[i];
+    if(c >= 0) {
+        QVector<int> &members = m_members[c];
+        int last = members.last();
+        members[m_slot[i]] = last;
+        m_slot[last] = m_slot[i];
+        members.removeLast();
+        if(members.isEmpty()) removeClass(c);
+    }
+
+    m_rate[i] = rate;
+    if(rate > 0.0) {
+        c = classOf(rate);
+        m_class[i] = c;
+        m_slot[i] = m_members[c].size();
+        m_members[c].append(i);
+    } else {
+        m_class[i] = -1;
+        m_slot[i] = -1;
+    }
+    m_totalValid = false;
+}
+
+double RateClassSelector::total() const
+{
+    if(!m_totalValid) {
+        m_total = 0.0;
+        foreach(int c, m_active) {
+            m_total += m_classRate[c]*m_members[c].size();
+        }
+        m_totalValid = true;
+    }
+    return m_total;
+}
+
+//choose the class by partial sums, then a uniform member within it
+int RateClassSelector::select(double ran) const
+{
+    double rateTotal = total();
+    if(rateTotal <= 0.0) return -1;
+
+    double target = ran*rateTotal;
+    int last = -1;
+    foreach(int c, m_active) {
+        int count = m_members[c].size();
+        double classTotal = m_classRate[c]*count;
+        if(target < classTotal) {
+            int member = int(target/m_classRate[c]);
+            if(member >= count) member = count - 1;
+            return m_members[c][member];
+        }
+        target -= classTotal;
+        last = c;
+    }
+    return m_members[last].last();
+}
+
+//the classes in scan order, each as its rate bit pattern, member count and
+//members
+QVector<quint64> RateClassSelector::state() const
+{
+    QVector<quint64> words;
+    words << m_active.size();
+    foreach(int c, m_active) {
+        quint64 key;
+        memcpy(&key, &m_classRate[c], sizeof(key));
+        words << key << m_members[c].size();
+        foreach(int i, m_members[c]) words << i;
+    }
+    return words;
+}
+
+bool RateClassSelector::setState(const QVector<quint64> &state)
+{
+    QVector<double> classRate;
+    QVector<QVector<int> > members;
+    QVector<int> slot(m_rate.size(), -1);
+    QVector<int> eventClass(m_rate.size(), -1);
+    QHash<quint64, int> classIndex;
+
+    //every event with a non-zero rate must appear once, in the class of its rate
+    //(empty classes, kept by older checkpoints, are dropped)
+    int pos = 0;
+    int nclasses = state.isEmpty() ? -1 : int(state[pos++]);
+    int placed = 0;
+    for(int n = 0; n < nclasses; n++) {
+        if(pos + 2 > state.size()) return false;
+        quint64 key = state[pos++];
+        quint64 count = state[pos++];
+        if(count > quint64(state.size() - pos) || classIndex.contains(key)) return false;
+        if(count == 0) continue;
+        int c = classRate.size();
+        double rate;
+        memcpy(&rate, &key, sizeof(rate));
+        classIndex.insert(key, c);
+        classRate.append(rate);
+        members.append(QVector<int>());
+        for(quint64 n = 0; n < count; n++) {
+            quint64 i = state[pos++];
+            if(i >= quint64(m_rate.size()) || eventClass[i] >= 0) return false;
+            if(memcmp(&m_rate[i], &key, sizeof(key)) != 0) return false;
+            eventClass[i] = c;
+            slot[i] = members[c].size();
+            members[c].append(i);
+            placed++;
+        }
+    }
+    if(nclasses < 0 || pos != state.size()) return false;
+    for(int i = 0; i < m_rate.size(); i++) {
+        if(m_rate[i] > 0.0) placed--;
+    }
+    if(placed != 0) return false;
+
+    m_classRate = classRate;
+    m_members = members;
+    m_slot = slot;
+    m_class = eventClass;
+    m_classIndex = classIndex;
+    m_active.resize(classRate.size());
+    for(int c = 0; c < m_active.size(); c++) m_active[c] = c;
+    m_activeSlot = m_active;
+    m_free.clear();
+    m_totalValid = false;
+    return true;
+}
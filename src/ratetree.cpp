@@ -0,0 +1,69 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "ratetree.h"
+
+RateTree::RateTree()
+{
+    resize(0);
+}
+
+void RateTree::resize(int n)
+{
+    m_size = n;
+    m_leaves = 1;
+    while(m_leaves < n) m_leaves *= 2;
+    m_tree.fill(0.0, 2*m_leaves);
+}
+
+void RateTree::setRates(const QVector<double> &rates)
+{
+    resize(rates.size());
+    for(int i = 0; i < m_size; i++) {
+        m_tree[m_leaves + i] = rates[i];
+    }
+    build();
+}
+
+//sum the internal nodes from the leaves
+void RateTree::build()
+{
+    for(int node = m_leaves - 1; node > 0; node--) {
+        m_tree[node] = m_tree[2*node] + m_tree[2*node + 1];
+    }
+}
+
+//set a leaf and re-sum its ancestors: the sums only depend on the current leaves
+void RateTree::setRate(int i, double rate)
+{
+    int node = m_leaves + i;
+    m_tree[node] = rate;
+    for(node /= 2; node > 0; node /= 2) {
+        m_tree[node] = m_tree[2*node] + m_tree[2*node + 1];
+    }
+}
+
+//descend from the root choosing the subtree containing ran*total
+int RateTree::select(double ran) const
+{
+    if(m_tree[1] <= 0.0) return -1;
+
+    double target = ran*m_tree[1];
+    int node = 1;
+    while(node < m_leaves) {
+        int left = 2*node;
+        if(target < m_tree[left] || m_tree[left + 1] <= 0.0) {
+            node = left;
+        } else {
+            target -= m_tree[left];
+            node = left + 1;
+        }
+    }
+    return node - m_leaves;
+}
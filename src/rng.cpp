@@ -0,0 +1,285 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "rng.h"
+
+RandomGenerator *RandomGenerator::create(Type type)
+{
+    if(type == Pcg64) return new PcgGenerator;
+    if(type == Philox) return new PhiloxGenerator;
+    return new XoshiroGenerator;
+}
+
+static inline quint64 rotl(quint64 x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+// full 64 x 64 -> 128 bit product
+static inline void mul64(quint64 a, quint64 b, quint64 *hi, quint64 *lo)
+{
+    quint64 a0 = a & 0xffffffffULL, a1 = a >> 32;
+    quint64 b0 = b & 0xffffffffULL, b1 = b >> 32;
+    quint64 p00 = a0*b0, p01 = a0*b1, p10 = a1*b0, p11 = a1*b1;
+    quint64 mid = (p00 >> 32) + (p01 & 0xffffffffULL) + (p10 & 0xffffffffULL);
+    *lo = (mid << 32) | (p00 & 0xffffffffULL);
+    *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+}
+
+// low 128 bits of a 128 x 128 bit product
+static inline void mul128(quint64 ahi, quint64 alo, quint64 bhi, quint64 blo,
+                          quint64 *hi, quint64 *lo)
+{
+    mul64(alo, blo, hi, lo);
+    *hi += ahi*blo + alo*bhi;
+}
+
+static inline void add128(quint64 ahi, quint64 alo, quint64 bhi, quint64 blo,
+                          quint64 *hi, quint64 *lo)
+{
+    *lo = alo + blo;
+    *hi = ahi + bhi + (*lo < alo ? 1 : 0);
+}
+
+// splitmix64: expands a seed into well mixed state words
+static quint64 splitmix(quint64 *x)
+{
+    quint64 z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro is linear over GF(2), so a run of jumps is a 256 x 256 bit
+// matrix: column j (four words) is the image of state bit j
+static void applyMatrix(const quint64 *matrix, const quint64 *s, quint64 *out)
+{
+    quint64 r[4] = { 0, 0, 0, 0 };
+    for(int j = 0; j < 256; j++) {
+        if((s[j >> 6] >> (j & 63)) & 1) {
+            for(int k = 0; k < 4; k++) r[k] ^= matrix[4*j + k];
+        }
+    }
+    for(int k = 0; k < 4; k++) out[k] = r[k];
+}
+
+// stream n starts n jumps into the sequence: the jumps are applied by the
+// binary digits of n, squaring the matrix of jump^(2^k) at each digit, so
+// any stream is reached in at most 64 matrix products
+void XoshiroGenerator::seed(quint64 seed, quint64 stream)
+{
+    quint64 x = seed;
+    for(int i = 0; i < 4; i++) {
+        m_s[i] = splitmix(&x);
+    }
+    if(stream == 0) return;
+
+    quint64 start[4];
+    for(int k = 0; k < 4; k++) start[k] = m_s[k];
+    QVector<quint64> power(4*256);
+    for(int j = 0; j < 256; j++) {
+        for(int k = 0; k < 4; k++) m_s[k] = 0;
+        m_s[j >> 6] = 1ULL << (j & 63);
+        jump();
+        for(int k = 0; k < 4; k++) power[4*j + k] = m_s[k];
+    }
+    for(int k = 0; k < 4; k++) m_s[k] = start[k];
+
+    QVector<quint64> square(4*256);
+    while(true) {
+        if(stream & 1) applyMatrix(power.constData(), m_s, m_s);
+        stream >>= 1;
+        if(stream == 0) break;
+        for(int j = 0; j < 256; j++) {
+            applyMatrix(power.constData(), power.constData() + 4*j, square.data() + 4*j);
+        }
+        power.swap(square);
+    }
+}
+
+quint64 XoshiroGenerator::next()
+{
+    quint64 result = rotl(m_s[1]*5, 7)*9;
+    quint64 t = m_s[1] << 17;
+    m_s[2] ^= m_s[0];
+    m_s[3] ^= m_s[1];
+    m_s[1] ^= m_s[2];
+    m_s[0] ^= m_s[3];
+    m_s[2] ^= t;
+    m_s[3] = rotl(m_s[3], 45);
+    return result;
+}
+
+void XoshiroGenerator::jump()
+{
+    static const quint64 jumpPoly[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                         0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+    quint64 s[4] = { 0, 0, 0, 0 };
+    for(int i = 0; i < 4; i++) {
+        for(int b = 0; b < 64; b++) {
+            if(jumpPoly[i] & (1ULL << b)) {
+                for(int k = 0; k < 4; k++) s[k] ^= m_s[k];
+            }
+            next();
+        }
+    }
+    for(int k = 0; k < 4; k++) m_s[k] = s[k];
+}
+
+QVector<quint64> XoshiroGenerator::state() const
+{
+    QVector<quint64> words(4);
+    for(int k = 0; k < 4; k++) words[k] = m_s[k];
+    return words;
+}
+
+bool XoshiroGenerator::setState(const QVector<quint64> &state)
+{
+    if(state.size() != 4) return false;
+    for(int k = 0; k < 4; k++) m_s[k] = state[k];
+    return true;
+}
+
+static const quint64 pcgMultHi = 2549297995355413924ULL;
+static const quint64 pcgMultLo = 4865540595714422341ULL;
+
+// seeding as pcg64(seed, stream) in the reference implementation
+void PcgGenerator::seed(quint64 seed, quint64 stream)
+{
+    m_incHi = stream >> 63;
+    m_incLo = (stream << 1) | 1;
+    m_stateHi = 0;
+    m_stateLo = 0;
+    next();
+    add128(m_stateHi, m_stateLo, 0, seed, &m_stateHi, &m_stateLo);
+    next();
+}
+
+quint64 PcgGenerator::next()
+{
+    mul128(m_stateHi, m_stateLo, pcgMultHi, pcgMultLo, &m_stateHi, &m_stateLo);
+    add128(m_stateHi, m_stateLo, m_incHi, m_incLo, &m_stateHi, &m_stateLo);
+    int rot = int(m_stateHi >> 58);
+    quint64 x = m_stateHi ^ m_stateLo;
+    return rot ? (x >> rot) | (x << (64 - rot)) : x;
+}
+
+// LCG skip ahead in O(log delta) (Brown, 1994)
+void PcgGenerator::advance(quint64 deltaHi, quint64 deltaLo)
+{
+    quint64 curMultHi = pcgMultHi, curMultLo = pcgMultLo;
+    quint64 curPlusHi = m_incHi, curPlusLo = m_incLo;
+    quint64 accMultHi = 0, accMultLo = 1;
+    quint64 accPlusHi = 0, accPlusLo = 0;
+    while(deltaHi || deltaLo) {
+        if(deltaLo & 1) {
+            mul128(accMultHi, accMultLo, curMultHi, curMultLo, &accMultHi, &accMultLo);
+            mul128(accPlusHi, accPlusLo, curMultHi, curMultLo, &accPlusHi, &accPlusLo);
+            add128(accPlusHi, accPlusLo, curPlusHi, curPlusLo, &accPlusHi, &accPlusLo);
+        }
+        quint64 hi, lo;
+        add128(curMultHi, curMultLo, 0, 1, &hi, &lo);
+        mul128(hi, lo, curPlusHi, curPlusLo, &curPlusHi, &curPlusLo);
+        mul128(curMultHi, curMultLo, curMultHi, curMultLo, &curMultHi, &curMultLo);
+        deltaLo = (deltaLo >> 1) | (deltaHi << 63);
+        deltaHi >>= 1;
+    }
+    mul128(accMultHi, accMultLo, m_stateHi, m_stateLo, &m_stateHi, &m_stateLo);
+    add128(m_stateHi, m_stateLo, accPlusHi, accPlusLo, &m_stateHi, &m_stateLo);
+}
+
+void PcgGenerator::jump()
+{
+    advance(1, 0);
+}
+
+QVector<quint64> PcgGenerator::state() const
+{
+    QVector<quint64> words;
+    words << m_stateHi << m_stateLo << m_incHi << m_incLo;
+    return words;
+}
+
+bool PcgGenerator::setState(const QVector<quint64> &state)
+{
+    //the increment is always odd
+    if(state.size() != 4 || !(state[3] & 1)) return false;
+    m_stateHi = state[0];
+    m_stateLo = state[1];
+    m_incHi = state[2];
+    m_incLo = state[3];
+    return true;
+}
+
+void PhiloxGenerator::seed(quint64 seed, quint64 stream)
+{
+    m_key[0] = seed;
+    m_key[1] = stream;
+    for(int i = 0; i < 4; i++) m_counter[i] = 0;
+    m_used = 4;
+}
+
+// ten rounds of the Philox bijection applied to the current counter
+void PhiloxGenerator::generate()
+{
+    quint64 c[4] = { m_counter[0], m_counter[1], m_counter[2], m_counter[3] };
+    quint64 k0 = m_key[0], k1 = m_key[1];
+    for(int round = 0; round < 10; round++) {
+        quint64 hi0, lo0, hi1, lo1;
+        mul64(0xd2e7470ee14c6c93ULL, c[0], &hi0, &lo0);
+        mul64(0xca5a826395121157ULL, c[2], &hi1, &lo1);
+        c[0] = hi1 ^ c[1] ^ k0;
+        c[1] = lo1;
+        c[2] = hi0 ^ c[3] ^ k1;
+        c[3] = lo0;
+        k0 += 0x9e3779b97f4a7c15ULL;
+        k1 += 0xbb67ae8584caa73bULL;
+    }
+    for(int i = 0; i < 4; i++) m_output[i] = c[i];
+
+    // step the lower 128 bits of the counter
+    if(++m_counter[0] == 0) m_counter[1]++;
+    m_used = 0;
+}
+
+quint64 PhiloxGenerator::next()
+{
+    if(m_used == 4) generate();
+    return m_output[m_used++];
+}
+
+void PhiloxGenerator::jump()
+{
+    if(++m_counter[2] == 0) m_counter[3]++;
+    m_counter[0] = 0;
+    m_counter[1] = 0;
+    m_used = 4;
+}
+
+//key, counter, the current output block and the position in it
+QVector<quint64> PhiloxGenerator::state() const
+{
+    QVector<quint64> words;
+    words << m_key[0] << m_key[1];
+    for(int i = 0; i < 4; i++) words << m_counter[i];
+    for(int i = 0; i < 4; i++) words << m_output[i];
+    words << quint64(m_used);
+    return words;
+}
+
+bool PhiloxGenerator::setState(const QVector<quint64> &state)
+{
+    if(state.size() != 11 || state[10] > 4) return false;
+    m_key[0] = state[0];
+    m_key[1] = state[1];
+    for(int i = 0; i < 4; i++) m_counter[i] = state[2 + i];
+    for(int i = 0; i < 4; i++) m_output[i] = state[6 + i];
+    m_used = int(state[10]);
+    return true;
+}
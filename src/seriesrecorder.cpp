@@ -0,0 +1,229 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "seriesrecorder.h"
+#include "checkpoint.h"
+
+static const char spillMagic[8] = { 'K', 'M', 'C', '2', 'D', 'S', 'E', 'R' };
+
+static const qint64 spillHeaderSize = sizeof(spillMagic) + 2*sizeof(quint32);
+
+static const char *columnNames[SeriesRecorder::ColumnCount] = { "time", "energy", "xdisp", "ydisp", "sqdisp" };
+
+const char *SeriesRecorder::columnName(Column column)
+{
+    return columnNames[column];
+}
+
+SeriesRecorder::SeriesRecorder(int window, int history)
+{
+    m_windowSize = qMax(1, window);
+    m_historySize = qMax(2, history);
+    m_spillFirst = 0;
+    m_spillRows = 0;
+    m_spillCut = -1;
+    m_spillFailed = false;
+    clear();
+}
+
+SeriesRecorder::~SeriesRecorder()
+{
+    closeSpill();
+}
+
+void SeriesRecorder::clear()
+{
+    m_count = 0;
+    m_stride = 1;
+    m_head = 0;
+    for(int c = 0; c < ColumnCount; c++) {
+        m_window[c].clear();
+        m_window[c].reserve(m_windowSize);
+        m_history[c].clear();
+    }
+    //the spill file is cut back before the next row, so a checkpoint loaded
+    //in between keeps the rows leading up to it
+    if(m_spill.isOpen()) m_spillCut = 0;
+}
+
+void SeriesRecorder::append(double time, double energy, double xdisp, double ydisp)
+{
+    double row[ColumnCount] = { time, energy, xdisp, ydisp, xdisp*xdisp + ydisp*ydisp };
+
+    if(m_window[0].size() < m_windowSize) {
+        for(int c = 0; c < ColumnCount; c++) m_window[c].append(row[c]);
+    } else {
+        //the oldest step leaves the window for the history
+        double old[ColumnCount];
+        for(int c = 0; c < ColumnCount; c++) {
+            old[c] = m_window[c][m_head];
+            m_window[c][m_head] = row[c];
+        }
+        decimate(m_count - m_windowSize, old);
+        m_head = (m_head + 1) % m_windowSize;
+    }
+    m_count++;
+
+    if(m_spill.isOpen()) {
+        if(m_spillCut >= 0) cutSpill();
+        for(int c = 0; c < ColumnCount; c++) m_chunk[c].append(row[c]);
+        m_spillRows++;
+        if(m_chunk[0].size() >= ChunkRows) writeChunk();
+    }
+}
+
+//keep steps at multiples of the stride: a full history keeps every other
+//point and doubles the stride
+void SeriesRecorder::decimate(qint64 index, const double *row)
+{
+    if(index % m_stride != 0) return;
+    if(m_history[0].size() >= m_historySize) {
+        for(int c = 0; c < ColumnCount; c++) {
+            QVector<double> &history = m_history[c];
+            int n = 0;
+            for(int k = 0; k < history.size(); k += 2) history[n++] = history[k];
+            history.resize(n);
+        }
+        m_stride *= 2;
+        if(index % m_stride != 0) return;
+    }
+    for(int c = 0; c < ColumnCount; c++) m_history[c].append(row[c]);
+}
+
+QVector<double> SeriesRecorder::series(Column column) const
+{
+    const QVector<double> &window = m_window[column];
+    QVector<double> values;
+    values.reserve(m_history[column].size() + window.size());
+    values += m_history[column];
+    for(int k = 0; k < window.size(); k++) {
+        values.append(window[(m_head + k) % window.size()]);
+    }
+    return values;
+}
+
+bool SeriesRecorder::openSpill(const QString &filename, QString *error)
+{
+    closeSpill();
+    m_spill.setFileName(filename);
+    if (!m_spill.open(QFile::ReadWrite | QFile::Truncate)) {
+        if(error) *error = "Error writing series file";
+        return false;
+    }
+    quint32 format[2] = { spillVersion, ColumnCount };
+    m_spillFailed = m_spill.write(spillMagic, sizeof(spillMagic)) != sizeof(spillMagic) ||
+            m_spill.write(reinterpret_cast<const char *>(format), sizeof(format)) != sizeof(format);
+    for(int c = 0; c < ColumnCount; c++) {
+        m_chunk[c].clear();
+        m_chunk[c].reserve(ChunkRows);
+    }
+    m_spillFirst = m_count;
+    m_spillRows = 0;
+    m_spillCut = -1;
+    return true;
+}
+
+bool SeriesRecorder::closeSpill(QString *error)
+{
+    if(!m_spill.isOpen()) return true;
+    if(m_spillCut >= 0) cutSpill();
+    writeChunk();
+    if(!m_spill.flush()) m_spillFailed = true;
+    m_spill.close();
+    for(int c = 0; c < ColumnCount; c++) m_chunk[c] = QVector<double>();
+    if(m_spillFailed && error) *error = "Error writing series file " + m_spill.fileName();
+    return !m_spillFailed;
+}
+
+// a failed write is latched and reported by closeSpill()
+void SeriesRecorder::writeChunk()
+{
+    qint64 rows = m_chunk[0].size();
+    if(rows == 0) return;
+    if(m_spill.write(reinterpret_cast<const char *>(&rows), sizeof(rows)) != sizeof(rows)) m_spillFailed = true;
+    for(int c = 0; c < ColumnCount; c++) {
+        qint64 size = rows*sizeof(double);
+        if(m_spill.write(reinterpret_cast<const char *>(m_chunk[c].constData()), size) != size) m_spillFailed = true;
+        m_chunk[c].clear();
+    }
+}
+
+//cut the spill file back to the rows of the steps before m_spillCut: the
+//chunk holding the cut is read back and written again with the next rows
+void SeriesRecorder::cutSpill()
+{
+    qint64 keep = qBound(qint64(0), m_spillCut - m_spillFirst, m_spillRows);
+    if(keep == 0) m_spillFirst = m_spillCut;
+    m_spillCut = -1;
+    qint64 written = m_spillRows - m_chunk[0].size();
+    m_spillRows = keep;
+    if(keep >= written) {
+        for(int c = 0; c < ColumnCount; c++) m_chunk[c].resize(int(keep - written));
+        return;
+    }
+
+    for(int c = 0; c < ColumnCount; c++) m_chunk[c].clear();
+    qint64 pos = spillHeaderSize;
+    qint64 rows = 0;
+    while(rows < keep) {
+        qint64 n;
+        if(!m_spill.seek(pos) || m_spill.read(reinterpret_cast<char *>(&n), sizeof(n)) != sizeof(n)) {
+            m_spillFailed = true;
+            break;
+        }
+        if(rows + n > keep) {
+            int part = int(keep - rows);
+            for(int c = 0; c < ColumnCount; c++) {
+                m_chunk[c].resize(part);
+                qint64 size = part*sizeof(double);
+                if(!m_spill.seek(pos + sizeof(n) + c*n*qint64(sizeof(double))) ||
+                        m_spill.read(reinterpret_cast<char *>(m_chunk[c].data()), size) != size) {
+                    m_spillFailed = true;
+                }
+            }
+            break;
+        }
+        pos += sizeof(n) + n*ColumnCount*qint64(sizeof(double));
+        rows += n;
+    }
+    if(!m_spill.resize(pos) || !m_spill.seek(pos)) m_spillFailed = true;
+}
+
+void SeriesRecorder::save(Checkpoint *checkpoint) const
+{
+    for(int c = 0; c < ColumnCount; c++) {
+        checkpoint->setSeries(QString(columnName(Column(c))) + ".history", m_history[c]);
+        checkpoint->setSeries(QString(columnName(Column(c))) + ".window", series(Column(c)).mid(m_history[c].size()));
+    }
+    checkpoint->setCounter("series.count", m_count);
+    checkpoint->setCounter("series.stride", m_stride);
+}
+
+void SeriesRecorder::load(const Checkpoint &checkpoint)
+{
+    clear();
+    for(int c = 0; c < ColumnCount; c++) {
+        m_history[c] = checkpoint.series(QString(columnName(Column(c))) + ".history");
+        QVector<double> window = checkpoint.series(QString(columnName(Column(c))) + ".window");
+        if(window.size() > m_windowSize) window = window.mid(window.size() - m_windowSize);
+        m_window[c] = window;
+        m_window[c].reserve(m_windowSize);
+    }
+    m_count = checkpoint.counter("series.count");
+    m_stride = int(qMax(qint64(1), checkpoint.counter("series.stride")));
+    if(m_spill.isOpen()) m_spillCut = m_count;
+
+    //the columns must agree: otherwise start again
+    for(int c = 1; c < ColumnCount; c++) {
+        if(m_history[c].size() != m_history[0].size() || m_window[c].size() != m_window[0].size()) {
+            clear();
+            return;
+        }
+    }
+}
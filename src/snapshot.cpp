@@ -0,0 +1,62 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "snapshot.h"
+
+SnapshotBuffer::SnapshotBuffer()
+    : m_back(0), m_front(1), m_middle(2)
+{
+    for(int i = 0; i < 3; i++) {
+        m_slots[i].steps = 0;
+        m_slots[i].time = 0.0;
+        m_slots[i].energy = 0.0;
+        m_slots[i].stalled = false;
+    }
+}
+
+//swap the filled slot into the middle and take back the old middle slot
+void SnapshotBuffer::publish()
+{
+    m_back = m_middle.fetchAndStoreOrdered(m_back | 4) & 3;
+}
+
+//swap the unread middle slot to the front
+bool SnapshotBuffer::read()
+{
+    if(!(m_middle.loadAcquire() & 4)) return false;
+    m_front = m_middle.fetchAndStoreOrdered(m_front) & 3;
+    return true;
+}
+
+ChunkQueue::ChunkQueue()
+    : m_head(0), m_tail(0)
+{
+    for(int i = 0; i < Capacity; i++) {
+        m_chunks[i] = 0;
+    }
+}
+
+bool ChunkQueue::push(SeriesChunk *chunk)
+{
+    int head = m_head.load();
+    int next = (head + 1) % Capacity;
+    if(next == m_tail.loadAcquire()) return false;
+    m_chunks[head] = chunk;
+    m_head.storeRelease(next);
+    return true;
+}
+
+SeriesChunk *ChunkQueue::pop()
+{
+    int tail = m_tail.load();
+    if(tail == m_head.loadAcquire()) return 0;
+    SeriesChunk *chunk = m_chunks[tail];
+    m_tail.storeRelease((tail + 1) % Capacity);
+    return chunk;
+}
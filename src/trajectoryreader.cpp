@@ -0,0 +1,231 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "trajectoryreader.h"
+
+#include <cstring>
+
+static const char trajectoryMagic[8] = { 'K', 'M', 'C', '2', 'D', 'T', 'R', 'J' };
+
+static bool trajectoryError(QString *error, const QString &message)
+{
+    if(error) *error = message;
+    return false;
+}
+
+TrajectoryReader::TrajectoryReader()
+{
+    m_data = 0;
+    m_events = 0;
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    close();
+}
+
+qint64 TrajectoryReader::keyBytes() const
+{
+    return ((qint64(m_header.nsites) + 63)/64)*sizeof(quint64);
+}
+
+qint64 TrajectoryReader::blockBytes() const
+{
+    return keyBytes() + qint64(m_header.keyInterval)*sizeof(TrajectoryRecord);
+}
+
+bool TrajectoryReader::open(const QString &filename, QString *error)
+{
+    close();
+    m_file.setFileName(filename);
+    if (!m_file.open(QFile::ReadOnly)) {
+        return trajectoryError(error, "Error reading trajectory file");
+    }
+    qint64 size = m_file.size();
+    if(size < qint64(sizeof(TrajectoryHeader))) {
+        m_file.close();
+        return trajectoryError(error, "Error. Malformed trajectory file: truncated header");
+    }
+    const uchar *data = m_file.map(0, size);
+    if(!data) {
+        m_file.close();
+        return trajectoryError(error, "Error mapping trajectory file");
+    }
+    m_data = data;
+
+    memcpy(&m_header, m_data, sizeof(m_header));
+    QString message;
+    if(memcmp(m_header.magic, trajectoryMagic, 8) != 0) {
+        message = "Error. Not a KMC2D trajectory file";
+    } else if(m_header.byteOrder != 0x01020304) {
+        message = "Error. Trajectory file has a different byte order";
+    } else if(m_header.version != version) {
+        message = "Error. Unsupported trajectory version " + QString::number(m_header.version);
+    } else if(m_header.nsites <= 0 || m_header.ntrans < 0 || m_header.keyInterval <= 0) {
+        message = "Error. Malformed trajectory file: bad header";
+    }
+
+    qint64 first = sizeof(TrajectoryHeader);
+    if(message.isEmpty() && m_header.indexOffset != 0) {
+        //closed trajectory: take the keyframes from the index footer
+        qint64 nkeys = m_header.keyCount;
+        m_events = m_header.events;
+        bool valid = m_events >= 0 && nkeys == m_events/m_header.keyInterval + 1 &&
+                m_header.indexOffset >= first + (nkeys - 1)*blockBytes() + keyBytes() +
+                (m_events - (nkeys - 1)*m_header.keyInterval)*qint64(sizeof(TrajectoryRecord)) &&
+                m_header.indexOffset + nkeys*qint64(sizeof(TrajectoryKey)) <= size;
+        if(valid) {
+            m_keys.resize(nkeys);
+            memcpy(m_keys.data(), m_data + m_header.indexOffset, nkeys*sizeof(TrajectoryKey));
+        }
+        for(int k = 0; valid && k < nkeys; k++) {
+            valid = m_keys[k].event == qint64(k)*m_header.keyInterval &&
+                    m_keys[k].offset == first + k*blockBytes();
+        }
+        if(!valid) message = "Error. Malformed trajectory file: bad index";
+    } else if(message.isEmpty()) {
+        //the run ended without closing the file: the block layout is fixed,
+        //so rebuild the index from whatever was written
+        qint64 avail = size - first;
+        qint64 nblocks = avail/blockBytes();
+        qint64 rest = avail - nblocks*blockBytes();
+        m_events = nblocks*m_header.keyInterval;
+        qint64 nkeys = nblocks;
+        if(rest >= keyBytes()) {
+            nkeys++;
+            m_events += (rest - keyBytes())/qint64(sizeof(TrajectoryRecord));
+        }
+        if(nkeys == 0) {
+            message = "Error. Malformed trajectory file: no keyframe";
+        } else {
+            m_keys.resize(nkeys);
+            for(int k = 0; k < nkeys; k++) {
+                m_keys[k].event = qint64(k)*m_header.keyInterval;
+                m_keys[k].step = step(m_keys[k].event);
+                m_keys[k].time = time(m_keys[k].event);
+                m_keys[k].offset = first + k*blockBytes();
+            }
+        }
+    }
+
+    if(!message.isEmpty()) {
+        close();
+        return trajectoryError(error, message);
+    }
+    return true;
+}
+
+void TrajectoryReader::close()
+{
+    if(m_data) m_file.unmap(const_cast<uchar *>(m_data));
+    m_file.close();
+    m_data = 0;
+    m_events = 0;
+    m_keys.clear();
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+const TrajectoryRecord &TrajectoryReader::record(qint64 event) const
+{
+    qint64 n = event - 1;
+    qint64 block = n/m_header.keyInterval;
+    qint64 offset = sizeof(TrajectoryHeader) + block*blockBytes() + keyBytes() +
+            (n - block*m_header.keyInterval)*sizeof(TrajectoryRecord);
+    return *reinterpret_cast<const TrajectoryRecord *>(m_data + offset);
+}
+
+qint64 TrajectoryReader::step(qint64 event) const
+{
+    return event > 0 ? record(event).step : m_header.step0;
+}
+
+double TrajectoryReader::time(qint64 event) const
+{
+    return event > 0 ? record(event).time : m_header.time0;
+}
+
+// steps and times increase along the trajectory: bisect the records
+qint64 TrajectoryReader::findStep(qint64 step) const
+{
+    qint64 lo = 0;
+    qint64 hi = m_events;
+    while(lo < hi) {
+        qint64 mid = (lo + hi + 1)/2;
+        if(this->step(mid) <= step) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+qint64 TrajectoryReader::findTime(double time) const
+{
+    qint64 lo = 0;
+    qint64 hi = m_events;
+    while(lo < hi) {
+        qint64 mid = (lo + hi + 1)/2;
+        if(this->time(mid) <= time) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+void TrajectoryReader::readKey(int k, QVector<char> *occ) const
+{
+    int nsites = m_header.nsites;
+    QVector<quint64> bits((nsites + 63)/64);
+    memcpy(bits.data(), m_data + m_keys[k].offset, bits.size()*sizeof(quint64));
+    occ->resize(nsites);
+    for(int i = 0; i < nsites; i++) {
+        (*occ)[i] = (bits[i >> 6] >> (i & 63)) & 1;
+    }
+}
+
+void TrajectoryReader::state(qint64 event, QVector<char> *occ) const
+{
+    event = qBound(qint64(0), event, m_events);
+    int k = qMin(event/m_header.keyInterval, qint64(m_keys.size() - 1));
+    readKey(k, occ);
+    move(m_keys[k].event, event, occ);
+}
+
+void TrajectoryReader::move(qint64 from, qint64 to, QVector<char> *occ, QVector<int> *changed) const
+{
+    from = qBound(qint64(0), from, m_events);
+    to = qBound(qint64(0), to, m_events);
+    uint nsites = m_header.nsites;
+
+    if(qAbs(to - from) > m_header.keyInterval) {
+        QVector<char> target;
+        state(to, &target);
+        if(changed) {
+            for(int i = 0; i < target.size(); i++) {
+                if(target[i] != occ->at(i)) changed->append(i);
+            }
+        }
+        *occ = target;
+        return;
+    }
+
+    //replay forwards, or undo backwards
+    for(qint64 n = from + 1; n <= to; n++) {
+        const TrajectoryRecord &r = record(n);
+        if(uint(r.from) >= nsites || uint(r.to) >= nsites) continue;
+        (*occ)[r.from] = 0;
+        (*occ)[r.to] = 1;
+        if(changed) *changed << r.from << r.to;
+    }
+    for(qint64 n = from; n > to; n--) {
+        const TrajectoryRecord &r = record(n);
+        if(uint(r.from) >= nsites || uint(r.to) >= nsites) continue;
+        (*occ)[r.to] = 0;
+        (*occ)[r.from] = 1;
+        if(changed) *changed << r.from << r.to;
+    }
+}
@@ -0,0 +1,325 @@
+/****************************************************************************
+** KMC2D: A 2D lattice kinetic Monte Carlo model constructor and simulator
+**
+** Built using Qt 5.6
+**
+** Tom Trevethan 2016
+** tptrevethan@googlemail.com
+****************************************************************************/
+
+#include "trajectorywriter.h"
+#include "lattice.h"
+#include "kmcengine.h"
+
+#include <QFileInfo>
+
+#include <cstring>
+
+TrajectoryWriter::TrajectoryWriter(QObject *parent)
+    : QThread(parent)
+{
+    m_open = false;
+    m_closing = false;
+    m_syncing = false;
+    m_resumed = false;
+    m_failed = false;
+    m_format = Xyz;
+    m_keyInterval = 10000;
+    m_stride = 1;
+    m_step0 = 0;
+    m_time0 = 0.0;
+    m_natoms = 0;
+    m_events = 0;
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    close();
+}
+
+bool TrajectoryWriter::open(const QString &filename, const Lattice &lattice, int stride,
+                            long step, double time, QString *error)
+{
+    close();
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate)) {
+        if(error) *error = "Error writing trajectory file";
+        return false;
+    }
+    m_format = QFileInfo(filename).suffix() == "ktr" ? Events : Xyz;
+
+    if(m_format == Events) {
+        //the event count and index are filled in by close()
+        memset(&m_header, 0, sizeof(m_header));
+        memcpy(m_header.magic, "KMC2DTRJ", 8);
+        m_header.byteOrder = 0x01020304;
+        m_header.version = TrajectoryReader::version;
+        m_header.nsites = lattice.siteCount();
+        m_header.ntrans = lattice.transCount();
+        m_header.keyInterval = m_keyInterval;
+        m_header.step0 = step;
+        m_header.time0 = time;
+        if(m_file.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header)) != sizeof(m_header)) {
+            m_file.close();
+            if(error) *error = "Error writing trajectory file";
+            return false;
+        }
+    }
+
+    m_index.clear();
+    m_resumed = false;
+    begin(lattice, stride, step, time, 0);
+    return true;
+}
+
+bool TrajectoryWriter::resume(const QString &filename, const Lattice &lattice, int stride,
+                              long step, qint64 events, qint64 offset, QString *error)
+{
+    close();
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QFile::ReadWrite) || m_file.size() < offset) {
+        m_file.close();
+        if(error) *error = "Error appending to trajectory file";
+        return false;
+    }
+    m_format = QFileInfo(filename).suffix() == "ktr" ? Events : Xyz;
+
+    m_index.clear();
+    if(m_format == Events) {
+        //reopen as an unclosed trajectory, so the reader rebuilds the
+        //keyframe index from the part that is kept
+        bool ok = m_file.read(reinterpret_cast<char *>(&m_header), sizeof(m_header)) == sizeof(m_header) &&
+                memcmp(m_header.magic, "KMC2DTRJ", 8) == 0;
+        m_header.events = 0;
+        m_header.keyCount = 0;
+        m_header.indexOffset = 0;
+        ok = ok && m_file.seek(0) &&
+                m_file.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header)) == sizeof(m_header) &&
+                m_file.resize(offset);
+        m_file.close();
+        TrajectoryReader reader;
+        QString message = ok ? QString() : QString("Error appending to trajectory file");
+        if(message.isEmpty() && reader.open(filename, &message)) {
+            if(reader.siteCount() != lattice.siteCount() || reader.transCount() != lattice.transCount() ||
+                    reader.eventCount() != events) {
+                message = "Error. The trajectory does not match the checkpoint";
+            }
+            m_keyInterval = reader.keyInterval();
+            step = reader.step(0);
+            qint64 blockBytes = (qint64(reader.siteCount()) + 63)/64*sizeof(quint64) +
+                    qint64(m_keyInterval)*sizeof(TrajectoryRecord);
+            for(qint64 event = 0; message.isEmpty() && event <= events; event += m_keyInterval) {
+                TrajectoryKey key;
+                key.event = event;
+                key.step = reader.step(event);
+                key.time = reader.time(event);
+                key.offset = sizeof(TrajectoryHeader) + m_index.size()*blockBytes;
+                m_index.append(key);
+            }
+        }
+        reader.close();
+        if(!message.isEmpty() || !m_file.open(QFile::ReadWrite)) {
+            m_file.close();
+            if(error) *error = message.isEmpty() ? "Error appending to trajectory file" : message;
+            return false;
+        }
+    }
+    //an XYZ file is only synced between frames, so the offset is a frame boundary
+    if(!m_file.resize(offset) || !m_file.seek(offset)) {
+        m_file.close();
+        if(error) *error = "Error appending to trajectory file";
+        return false;
+    }
+
+    m_resumed = true;
+    begin(lattice, stride, step, 0.0, events);
+    return true;
+}
+
+void TrajectoryWriter::begin(const Lattice &lattice, int stride, long step, double time, qint64 events)
+{
+    // positions in Angstrom, the particles are the occupied sites
+    m_occ.resize(lattice.siteCount());
+    m_siteLine.resize(lattice.siteCount());
+    m_natoms = 0;
+    for(int i = 0; i < lattice.siteCount(); i++) {
+        m_occ[i] = lattice.occ(i);
+        m_natoms += m_occ[i];
+        m_siteLine[i] = "C " + QByteArray::number(lattice.x(i)*KmcEngine::lengthScale) + " " +
+                QByteArray::number(lattice.y(i)*KmcEngine::lengthScale) + " 0.0\n";
+    }
+
+    m_stride = m_format == Events ? 1 : qMax(1, stride);
+    m_step0 = step;
+    m_time0 = time;
+    m_pending.clear();
+    m_pending.reserve(BlockSize);
+    m_queue.clear();
+    m_events = events;
+    m_closing = false;
+    m_syncing = false;
+    m_failed = false;
+    m_open = true;
+    start();
+}
+
+void TrajectoryWriter::record(long step, double time, int trans, int from, int to)
+{
+    TrajectoryStep entry;
+    entry.step = step;
+    entry.time = time;
+    entry.trans = trans;
+    entry.from = from;
+    entry.to = to;
+    m_pending.append(entry);
+    if(m_pending.size() >= BlockSize) submit();
+}
+
+// hand the pending block to the writer: waits only if the writer is a
+// whole queue behind
+void TrajectoryWriter::submit()
+{
+    if(m_pending.isEmpty()) return;
+    QMutexLocker locker(&m_mutex);
+    while(m_queue.size() >= MaxBlocks) {
+        m_notFull.wait(&m_mutex);
+    }
+    m_queue.enqueue(m_pending);
+    m_pending.clear();
+    m_pending.reserve(BlockSize);
+    m_notEmpty.wakeOne();
+}
+
+bool TrajectoryWriter::sync(qint64 *events, qint64 *offset)
+{
+    if(!m_open) return false;
+    submit();
+    QMutexLocker locker(&m_mutex);
+    m_syncing = true;
+    m_notEmpty.wakeOne();
+    while(m_syncing) {
+        m_synced.wait(&m_mutex);
+    }
+    *events = m_events;
+    *offset = m_file.pos();
+    return !m_failed;
+}
+
+bool TrajectoryWriter::close(QString *error)
+{
+    if(!m_open) return true;
+    submit();
+    m_mutex.lock();
+    m_closing = true;
+    m_notEmpty.wakeOne();
+    m_mutex.unlock();
+    wait();
+    if(m_format == Events && !writeIndex()) m_failed = true;
+    if(!m_file.flush()) m_failed = true;
+    m_file.close();
+    m_open = false;
+    if(m_failed && error) *error = "Error writing trajectory file " + m_file.fileName();
+    return !m_failed;
+}
+
+// writer thread: a failed write is latched for sync() and close()
+void TrajectoryWriter::flushBuffer()
+{
+    if(m_file.write(m_buffer) != m_buffer.size()) m_failed = true;
+    m_buffer.clear();
+}
+
+void TrajectoryWriter::writeFrame(long step, double time)
+{
+    m_buffer += QByteArray::number(m_natoms);
+    m_buffer += "\nstep " + QByteArray::number(qlonglong(step)) +
+            " time " + QByteArray::number(time, 'g', 10) + "\n";
+    for(int i = 0; i < m_occ.size(); i++) {
+        if(m_occ[i]) m_buffer += m_siteLine[i];
+    }
+    if(m_buffer.size() > (1 << 20)) flushBuffer();
+}
+
+// a keyframe is the whole occupation, one bit per site
+void TrajectoryWriter::writeKeyframe(long step, double time)
+{
+    TrajectoryKey key;
+    key.event = m_events;
+    key.step = step;
+    key.time = time;
+    key.offset = m_file.pos() + m_buffer.size();
+    m_index.append(key);
+
+    QVector<quint64> bits((m_occ.size() + 63)/64, 0);
+    for(int i = 0; i < m_occ.size(); i++) {
+        if(m_occ[i]) bits[i >> 6] |= quint64(1) << (i & 63);
+    }
+    m_buffer.append(reinterpret_cast<const char *>(bits.constData()), bits.size()*sizeof(quint64));
+}
+
+void TrajectoryWriter::writeEvent(const TrajectoryStep &entry)
+{
+    TrajectoryRecord record;
+    record.step = entry.step;
+    record.time = entry.time;
+    record.trans = entry.trans;
+    record.from = entry.from;
+    record.to = entry.to;
+    record.reserved = 0;
+    m_buffer.append(reinterpret_cast<const char *>(&record), sizeof(record));
+    m_events++;
+    if(m_events % m_keyInterval == 0) writeKeyframe(entry.step, entry.time);
+    if(m_buffer.size() > (1 << 20)) flushBuffer();
+}
+
+// append the keyframe index and complete the header
+bool TrajectoryWriter::writeIndex()
+{
+    m_header.events = m_events;
+    m_header.keyCount = m_index.size();
+    m_header.indexOffset = m_file.pos();
+    qint64 size = m_index.size()*sizeof(TrajectoryKey);
+    if(m_file.write(reinterpret_cast<const char *>(m_index.constData()), size) != size) return false;
+    m_file.seek(0);
+    return m_file.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header)) == sizeof(m_header);
+}
+
+void TrajectoryWriter::run()
+{
+    if(!m_resumed) {
+        if(m_format == Events) writeKeyframe(m_step0, m_time0);
+        else writeFrame(m_step0, m_time0);
+    }
+    while(true) {
+        m_mutex.lock();
+        while(m_queue.isEmpty() && !m_closing && !m_syncing) {
+            m_notEmpty.wait(&m_mutex);
+        }
+        if(m_queue.isEmpty() && m_syncing) {
+            //the simulation waits for this, so write everything out under the lock
+            flushBuffer();
+            if(!m_file.flush()) m_failed = true;
+            m_syncing = false;
+            m_synced.wakeAll();
+            m_mutex.unlock();
+            continue;
+        }
+        if(m_queue.isEmpty()) {
+            m_mutex.unlock();
+            break;
+        }
+        QVector<TrajectoryStep> block = m_queue.dequeue();
+        m_notFull.wakeOne();
+        m_mutex.unlock();
+
+        foreach(const TrajectoryStep &entry, block) {
+            m_occ[entry.from] = 0;
+            m_occ[entry.to] = 1;
+            if(m_format == Events) writeEvent(entry);
+            else if((entry.step - m_step0) % m_stride == 0) writeFrame(entry.step, entry.time);
+        }
+    }
+    flushBuffer();
+}